@@ -0,0 +1,469 @@
+/*
+** Multi-threaded benchmark of elr_mpl against the system malloc, linux only.
+**
+** Build from the root of the repository:
+**   gcc -O2 -DELR_USE_THREAD -Iinc src/elr_mpl.c src/elr_mtx.c bench/bench.c \
+**       -o elr_bench -pthread -latomic
+** Run:
+**   ./elr_bench [max_threads] [ops_per_thread]
+**
+** Workloads:
+**   fixed    random alloc/free of 64 byte blocks over a working set per thread.
+**   multi    the same with a realistic size distribution, 16 bytes to 32KB,
+**            through elr_mpl_alloc_multi on a multi pool
+**            with the classes of the global one.
+**   large    buffers of 64KB to 4MB, every page touched.
+**   xthread  producer/consumer pairs, blocks alloced by one thread and freed
+**            by the other.
+**
+** Each workload runs with 1, 2, 4 ... max_threads threads. Reported are
+** throughput, percentiles of ticks per operation and the RSS of the process
+** while the working sets are held. Throughput is timed from the first
+** operation of any thread to the last one of any thread. Ticks are TSC cycles on x86 and
+** nanoseconds elsewhere. Pools are trimmed and malloc_trim is called between
+** runs, still the RSS is of the whole process, compare it run by run.
+*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "elr_mpl.h"
+
+#define BENCH_WORKING_SET      1024
+#define BENCH_LARGE_SET        16
+#define BENCH_RING_SIZE        1024
+#define BENCH_SAMPLE_COUNT     65536
+#define BENCH_FIXED_SIZE       64
+
+#define BENCH_FIXED            0
+#define BENCH_MULTI            1
+#define BENCH_LARGE            2
+#define BENCH_XTHREAD          3
+#define BENCH_WORKLOAD_COUNT   4
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BENCH_TICK_UNIT        "cycles"
+#else
+#define BENCH_TICK_UNIT        "ns"
+#endif
+
+typedef struct __bench_allocator
+{
+	const char  *name;
+	void*      (*alloc)(size_t size);
+	void       (*free)(void* mem);
+	/*only serves BENCH_FIXED_SIZE bytes*/
+	int          fixed_only;
+}
+bench_allocator;
+
+/*single producer single consumer ring of blocks*/
+typedef struct __bench_ring
+{
+	void        *slots[BENCH_RING_SIZE];
+	atomic_ulong head;
+	atomic_ulong tail;
+}
+bench_ring;
+
+typedef struct __bench_thread
+{
+	const bench_allocator *allocator;
+	int                    workload;
+	int                    id;
+	size_t                 ops;
+	unsigned int           seed;
+	bench_ring            *ring;
+	pthread_barrier_t     *barrier;
+	unsigned long long    *samples;
+	size_t                 sample_count;
+	/*wall clock of the first and the last operation of the thread*/
+	double                 start;
+	double                 end;
+}
+bench_thread;
+
+static elr_mpl_t  g_fixed_pool;
+static elr_mpl_t  g_multi_pool;
+static const char *g_workload_names[BENCH_WORKLOAD_COUNT] = { "fixed", "multi", "large", "xthread" };
+
+static void* malloc_alloc(size_t size) { return malloc(size); }
+static void  malloc_free(void* mem) { free(mem); }
+static void* mpl_multi_alloc(size_t size) { return elr_mpl_alloc_multi(&g_multi_pool, size); }
+static void* mpl_cached_alloc(size_t size) { return elr_mpl_alloc(&g_fixed_pool); }
+
+static const bench_allocator g_allocators[] =
+{
+	{ "malloc", malloc_alloc, malloc_free, 0 },
+	{ "elr_multi", mpl_multi_alloc, elr_mpl_free, 0 },
+	{ "elr_cached", mpl_cached_alloc, elr_mpl_free, 1 },
+};
+
+static unsigned long long bench_ticks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+static double bench_seconds()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static size_t bench_rss()
+{
+	unsigned long pages = 0;
+	unsigned long resident = 0;
+	FILE *f = fopen("/proc/self/statm", "r");
+
+	if (f == NULL)
+		return 0;
+	if (fscanf(f, "%lu %lu", &pages, &resident) != 2)
+		resident = 0;
+	fclose(f);
+	return (size_t)resident * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+/*
+** sizes of typical heap objects: most are small, a few are a page or more.
+*/
+static size_t bench_multi_size(unsigned int *seed)
+{
+	int r = rand_r(seed) % 100;
+
+	if (r < 60)
+		return 16 + rand_r(seed) % 113;
+	if (r < 90)
+		return 128 + rand_r(seed) % 897;
+	if (r < 99)
+		return 1024 + rand_r(seed) % 7169;
+	return 8192 + rand_r(seed) % 24577;
+}
+
+static size_t bench_large_size(unsigned int *seed)
+{
+	return (size_t)65536 << (rand_r(seed) % 7);
+}
+
+static void bench_touch(char *mem, size_t size)
+{
+	size_t i = 0;
+
+	for (i = 0; i < size; i += 4096)
+		mem[i] = 1;
+	mem[size - 1] = 1;
+}
+
+static void bench_sample(bench_thread *ctx, size_t op, unsigned long long ticks)
+{
+	size_t stride = ctx->ops / BENCH_SAMPLE_COUNT + 1;
+
+	if (op % stride == 0 && ctx->sample_count < BENCH_SAMPLE_COUNT)
+		ctx->samples[ctx->sample_count++] = ticks;
+}
+
+static void bench_random(bench_thread *ctx)
+{
+	void   *slots[BENCH_WORKING_SET];
+	size_t  count = ctx->workload == BENCH_LARGE ? BENCH_LARGE_SET : BENCH_WORKING_SET;
+	size_t  size = BENCH_FIXED_SIZE;
+	size_t  op = 0;
+	size_t  k = 0;
+	unsigned long long start = 0;
+
+	memset(slots, 0, sizeof(slots));
+	pthread_barrier_wait(ctx->barrier);
+	ctx->start = bench_seconds();
+
+	for (op = 0; op < ctx->ops; op++)
+	{
+		k = rand_r(&ctx->seed) % count;
+		if (slots[k] == NULL)
+		{
+			if (ctx->workload == BENCH_MULTI)
+				size = bench_multi_size(&ctx->seed);
+			else if (ctx->workload == BENCH_LARGE)
+				size = bench_large_size(&ctx->seed);
+			start = bench_ticks();
+			slots[k] = ctx->allocator->alloc(size);
+			bench_sample(ctx, op, bench_ticks() - start);
+			if (slots[k] != NULL)
+			{
+				if (ctx->workload == BENCH_LARGE)
+					bench_touch((char*)slots[k], size);
+				else
+					*(char*)slots[k] = 1;
+			}
+		}
+		else
+		{
+			start = bench_ticks();
+			ctx->allocator->free(slots[k]);
+			bench_sample(ctx, op, bench_ticks() - start);
+			slots[k] = NULL;
+		}
+	}
+	ctx->end = bench_seconds();
+
+	/*the main thread measures RSS between the two barriers*/
+	pthread_barrier_wait(ctx->barrier);
+	pthread_barrier_wait(ctx->barrier);
+
+	for (k = 0; k < count; k++)
+	{
+		if (slots[k] != NULL)
+			ctx->allocator->free(slots[k]);
+	}
+}
+
+static void bench_produce(bench_thread *ctx)
+{
+	bench_ring *ring = ctx->ring;
+	unsigned long head = 0;
+	size_t  op = 0;
+	void   *mem = NULL;
+	unsigned long long start = 0;
+
+	pthread_barrier_wait(ctx->barrier);
+	ctx->start = bench_seconds();
+
+	for (op = 0; op < ctx->ops; op++)
+	{
+		start = bench_ticks();
+		mem = ctx->allocator->alloc(BENCH_FIXED_SIZE);
+		bench_sample(ctx, op, bench_ticks() - start);
+		if (mem != NULL)
+			*(char*)mem = 1;
+
+		head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+		while (head - atomic_load_explicit(&ring->tail, memory_order_acquire) == BENCH_RING_SIZE)
+			sched_yield();
+		ring->slots[head % BENCH_RING_SIZE] = mem;
+		atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+	}
+	ctx->end = bench_seconds();
+
+	pthread_barrier_wait(ctx->barrier);
+	pthread_barrier_wait(ctx->barrier);
+}
+
+static void bench_consume(bench_thread *ctx)
+{
+	bench_ring *ring = ctx->ring;
+	unsigned long tail = 0;
+	size_t  op = 0;
+	void   *mem = NULL;
+	unsigned long long start = 0;
+
+	pthread_barrier_wait(ctx->barrier);
+	ctx->start = bench_seconds();
+
+	for (op = 0; op < ctx->ops; op++)
+	{
+		tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+		while (atomic_load_explicit(&ring->head, memory_order_acquire) == tail)
+			sched_yield();
+		mem = ring->slots[tail % BENCH_RING_SIZE];
+		atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+
+		if (mem != NULL)
+		{
+			start = bench_ticks();
+			ctx->allocator->free(mem);
+			bench_sample(ctx, op, bench_ticks() - start);
+		}
+	}
+	ctx->end = bench_seconds();
+
+	pthread_barrier_wait(ctx->barrier);
+	pthread_barrier_wait(ctx->barrier);
+}
+
+static void* bench_thread_main(void *arg)
+{
+	bench_thread *ctx = (bench_thread*)arg;
+
+	if (ctx->workload != BENCH_XTHREAD)
+		bench_random(ctx);
+	else if (ctx->id % 2 == 0)
+		bench_produce(ctx);
+	else
+		bench_consume(ctx);
+
+	return NULL;
+}
+
+static int bench_compare(const void *a, const void *b)
+{
+	unsigned long long x = *(const unsigned long long*)a;
+	unsigned long long y = *(const unsigned long long*)b;
+	return x < y ? -1 : x > y ? 1 : 0;
+}
+
+static unsigned long long bench_percentile(unsigned long long *sorted, size_t n, double pct)
+{
+	size_t k = 0;
+
+	if (n == 0)
+		return 0;
+	k = (size_t)(pct / 100 * (n - 1) + 0.5);
+	return sorted[k];
+}
+
+static void bench_run(const bench_allocator *allocator, int workload, int threads, size_t ops)
+{
+	bench_thread      *ctx = NULL;
+	pthread_t         *tids = NULL;
+	bench_ring        *rings = NULL;
+	unsigned long long *all = NULL;
+	pthread_barrier_t  barrier;
+	size_t             total = 0;
+	size_t             rss = 0;
+	double             start = 0;
+	double             end = 0;
+	int                i = 0;
+
+	if (workload == BENCH_LARGE)
+		ops /= 64;
+
+	ctx = (bench_thread*)calloc(threads, sizeof(bench_thread));
+	tids = (pthread_t*)calloc(threads, sizeof(pthread_t));
+	rings = (bench_ring*)calloc(threads / 2 + 1, sizeof(bench_ring));
+	all = (unsigned long long*)malloc((size_t)threads * BENCH_SAMPLE_COUNT * sizeof(unsigned long long));
+	if (ctx == NULL || tids == NULL || rings == NULL || all == NULL)
+	{
+		fprintf(stderr, "out of memory.\n");
+		exit(1);
+	}
+	pthread_barrier_init(&barrier, NULL, threads + 1);
+
+	for (i = 0; i < threads; i++)
+	{
+		ctx[i].allocator = allocator;
+		ctx[i].workload = workload;
+		ctx[i].id = i;
+		ctx[i].ops = ops;
+		ctx[i].seed = 12345u + i;
+		ctx[i].ring = &rings[i / 2];
+		ctx[i].barrier = &barrier;
+		ctx[i].samples = all + (size_t)i * BENCH_SAMPLE_COUNT;
+		pthread_create(&tids[i], NULL, bench_thread_main, &ctx[i]);
+	}
+
+	pthread_barrier_wait(&barrier);
+	pthread_barrier_wait(&barrier);
+	rss = bench_rss();
+	pthread_barrier_wait(&barrier);
+
+	for (i = 0; i < threads; i++)
+		pthread_join(tids[i], NULL);
+
+	/*the main thread may wake up late from the barriers, the threads time themselves*/
+	start = ctx[0].start;
+	end = ctx[0].end;
+	for (i = 1; i < threads; i++)
+	{
+		if (ctx[i].start < start)
+			start = ctx[i].start;
+		if (ctx[i].end > end)
+			end = ctx[i].end;
+	}
+
+	/*samples of all threads are packed to the front*/
+	for (i = 0; i < threads; i++)
+	{
+		memmove(all + total, ctx[i].samples, ctx[i].sample_count * sizeof(unsigned long long));
+		total += ctx[i].sample_count;
+	}
+	qsort(all, total, sizeof(unsigned long long), bench_compare);
+
+	printf("%-8s %-11s %7d %10.1f %10llu %10llu %10llu %10.1f\n",
+		g_workload_names[workload], allocator->name, threads,
+		(double)ops * threads / (end - start) / 1e3,
+		bench_percentile(all, total, 50),
+		bench_percentile(all, total, 99),
+		bench_percentile(all, total, 99.9),
+		rss / 1048576.0);
+	fflush(stdout);
+
+	pthread_barrier_destroy(&barrier);
+	free(all);
+	free(rings);
+	free(tids);
+	free(ctx);
+
+	elr_mpl_trim(&g_fixed_pool, 0);
+	elr_mpl_trim(&g_multi_pool, 1);
+	malloc_trim(0);
+}
+
+int main(int argc, char *argv[])
+{
+	int    max_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	size_t ops = 1000000;
+	int    workload = 0;
+	int    threads = 0;
+	size_t a = 0;
+	size_t obj_size[13] = { 64, 98, 128, 192, 256, 384, 512, 768, 1024, 1280, 1536, 1792, 2048 };
+
+	if (argc > 1)
+		max_threads = atoi(argv[1]);
+	if (argc > 2)
+		ops = (size_t)atol(argv[2]);
+	if (max_threads < 1)
+		max_threads = 1;
+
+	elr_mpl_init();
+	g_fixed_pool = elr_mpl_create_cached(NULL, BENCH_FIXED_SIZE, 64, NULL, NULL);
+	/*the same classes as the global multi pool*/
+	g_multi_pool = elr_mpl_create_multi_sync(NULL, 13, obj_size, NULL, NULL);
+
+	printf("%-8s %-11s %7s %10s %10s %10s %10s %10s\n",
+		"workload", "allocator", "threads", "kops/s", "p50", "p99", "p99.9", "rss_MB");
+	printf("%-8s %-11s %7s %10s %10s %10s %10s %10s\n",
+		"", "", "", "", BENCH_TICK_UNIT, BENCH_TICK_UNIT, BENCH_TICK_UNIT, "");
+
+	for (workload = 0; workload < BENCH_WORKLOAD_COUNT; workload++)
+	{
+		for (threads = workload == BENCH_XTHREAD ? 2 : 1; ; threads *= 2)
+		{
+			if (threads > max_threads)
+				threads = max_threads;
+			if (workload == BENCH_XTHREAD)
+				threads &= ~1;
+			if (threads < 1 || (workload == BENCH_XTHREAD && threads < 2))
+				break;
+
+			for (a = 0; a < sizeof(g_allocators) / sizeof(g_allocators[0]); a++)
+			{
+				if (g_allocators[a].fixed_only != 0
+					&& workload != BENCH_FIXED && workload != BENCH_XTHREAD)
+					continue;
+				bench_run(&g_allocators[a], workload, threads, ops);
+			}
+
+			if (threads >= max_threads || (workload == BENCH_XTHREAD && threads + 1 >= max_threads))
+				break;
+		}
+	}
+
+	elr_mpl_destroy(&g_multi_pool);
+	elr_mpl_destroy(&g_fixed_pool);
+	elr_mpl_finalize();
+	return 0;
+}
@@ -32,10 +32,11 @@
  *  can destroy all memory pool by invoke elr_mpl_finalize function.
  *  
  *  this memory pool also support muti-threading using. if we want it works
- *  in muti-theading entironment, we must implement all the six interface
+ *  in muti-theading entironment, we must implement all the interface
  *  defined in file elr_mtx.h and define ELR_USE_THREAD. fortunately, it is
- *  a very easy job, and the implementation of windows platform is already
- *  provided.
+ *  a very easy job, and the implementation of windows platform and linux
+ *  platform is already provided. on linux, link with -pthread and -latomic
+ *  (or compile with -mcx16 on x86-64).
  *
  *  when i make the windows implementation, i take linux into consideration.
  *  so the atomic counter(interger) type and counter value type is defined
@@ -105,6 +106,89 @@ typedef struct __elr_mpl_t
 }
 elr_mpl_t,*elr_mpl_ht;
 
+/*! \brief statistics of memory pools, see elr_mpl_stats.
+ *
+ *  memory blocks kept in thread caches count as in use. counts of thread
+ *  caches are merged into their pool when the cache refills or flushes.
+ */
+typedef struct __elr_mpl_stats_t
+{
+	size_t  pool_count; /*!< count of memory pools summed up. */
+	size_t  node_count; /*!< count of nodes held. */
+	size_t  slice_count; /*!< count of memory blocks in use. */
+	size_t  free_slice_count; /*!< count of memory blocks available in nodes held. */
+	size_t  peak_slice_count; /*!< sum of high-water marks of memory blocks in use. */
+	size_t  reserved_size; /*!< bytes of nodes held. */
+	size_t  requested_size; /*!< bytes of memory blocks in use. */
+	size_t  alloc_count; /*!< count of memory blocks alloced. */
+	size_t  free_count; /*!< count of memory blocks freed. */
+	size_t  node_alloc_count; /*!< count of nodes alloced from the system. */
+}
+elr_mpl_stats_t;
+
+/*! \brief internal fragmentation of a size class, see elr_mpl_class_stats.
+ *
+ *  request counts are only recorded when the library is compiled with
+ *  ELR_USE_HISTOGRAM, and are zero otherwise.
+ */
+typedef struct __elr_mpl_class_stats_t
+{
+	size_t              object_size; /*!< size of memory blocks of the class. */
+	size_t              slice_count; /*!< count of memory blocks in use. */
+	unsigned long long  request_count; /*!< count of requests served by the class. */
+	unsigned long long  requested_size; /*!< bytes asked for by those requests. */
+	unsigned long long  wasted_size; /*!< bytes handed out beyond those requests. */
+}
+elr_mpl_class_stats_t;
+
+/*! \brief position in an arena pool, see elr_mpl_mark and elr_mpl_rewind.
+ *
+ *  don`t modify it`s members manualy.
+ */
+typedef struct __elr_mpl_mark_t
+{
+	void*   node; /*!< the node being carved, NULL if none. */
+	void*   avail; /*!< the first available byte of the node. */
+	size_t  count; /*!< count of memory blocks alloced. */
+}
+elr_mpl_mark_t;
+
+/*! \brief memory pool created on first use, see elr_mpl_lazy.
+ *
+ *  declare it with static storage duration, it is zero initialized.
+ *  don`t modify it`s members manualy.
+ */
+typedef struct __elr_mpl_lazy_t
+{
+	elr_mpl_t     mpl; /*!< the memory pool. */
+	volatile int  epoch; /*!< the initialization of the module mpl belongs to, 0 if none. */
+}
+elr_mpl_lazy_t;
+
+/** creates the memory pool of elr_mpl_lazy. */
+typedef elr_mpl_t (*elr_mpl_factory)(void* arg);
+
+/*! \def ELR_MPL_LATENCY_ALLOC
+ *  \brief latency kind of elr_mpl_alloc and elr_mpl_alloc_multi.
+ */
+#define ELR_MPL_LATENCY_ALLOC    0
+/*! \def ELR_MPL_LATENCY_FREE
+ *  \brief latency kind of elr_mpl_free.
+ */
+#define ELR_MPL_LATENCY_FREE     1
+/*! \def ELR_MPL_LATENCY_REFILL
+ *  \brief latency kind of getting a node from the system.
+ */
+#define ELR_MPL_LATENCY_REFILL   2
+/*! \def ELR_MPL_LATENCY_LOCK
+ *  \brief latency kind of waiting for the lock of a pool.
+ */
+#define ELR_MPL_LATENCY_LOCK     3
+/*! \def ELR_MPL_LATENCY_KINDS
+ *  \brief count of latency kinds.
+ */
+#define ELR_MPL_LATENCY_KINDS    4
+
 
 /*! \def ELR_MPL_INITIALIZER
  *  \brief elr_mpl_t constant for initializing.
@@ -127,6 +211,43 @@ extern ELR_MPL_API elr_mpl_t ELR_MPL_INITIALIZER;
  */
 ELR_MPL_API int elr_mpl_init();
 
+/*
+** ʼڴأָȫֶߴڴصĳߴ
+** obj_sizeӦôСУΪNULLʱʹelr_mpl_initͬĬϳߴ
+** ڴģѾʼʱߴá
+** 0ʾʼʧ
+*/
+/*! \brief initialize memory pool module with the size classes of the global multi pool.
+ *  \param obj_size_count count of size classes.
+ *  \param obj_size size classes in ascending order, NULL for the default ones.
+ *  \retval zero if failed.
+ *
+ *  the table only takes effect on the first initialization.
+ *  see elr_mpl_geometric_classes for generating a table.
+ */
+ELR_MPL_API int elr_mpl_init_ex(int obj_size_count, const size_t* obj_size);
+
+/*
+** ɰμĳߴڳߴ֮ʹڲƬmax_waste
+** سߴдcapacityobj_sizeΪNULLʱֻ
+*/
+/*! \brief generate size classes spaced geometrically.
+ *  \param min_size the smallest class.
+ *  \param max_size the largest class is the first one not less than it.
+ *  \param max_waste bound of wasted bytes over block size, between 0 and 1.
+ *  \param obj_size array to receive the classes.
+ *  \param capacity count of elements of obj_size.
+ *  \retval count of classes, which may exceed capacity.
+ *
+ *  classes are multiples of the size of a pointer, so classes closer than
+ *  that are merged and the bound may not hold for tiny sizes.
+ */
+ELR_MPL_API int elr_mpl_geometric_classes(size_t min_size,
+	size_t max_size,
+	double max_waste,
+	size_t* obj_size,
+	int capacity);
+
 /*
 ** һڴأָ䵥ԪС
 ** һʾڴأΪNULLʾڴصĸڴȫڴء
@@ -156,6 +277,212 @@ ELR_MPL_API elr_mpl_t elr_mpl_create_sync(elr_mpl_ht fpool,
 	elr_mpl_callback on_alloc,
 	elr_mpl_callback on_free);
 
+/*
+** һֺ֧̻߳ͬ߳ڴأָ䵥ԪС
+** ʾÿ߳໺Ŀڴ
+** 治Ϊʱͷڴ治Ҫ߳˳ʱ黹ڴء
+*/
+/*! \brief create a memory pool with per-thread caches.
+ *  \param fpool the parent pool of the about to created pool.
+ *  \param obj_size the size of memory block can alloc from the pool.
+ *  \param cache_size the max count of free memory blocks cached by each thread.
+ *  \param on_alloc the function that will called after memory alloced.
+ *  \param on_free the function that will called before free memory.
+ *  \retval NULL if failed.
+ *
+ *  each thread keeps a bounded stack of free blocks in front of the pool,
+ *  refilled and flushed in batches under the pool lock. the cache of a thread
+ *  is given back to the pool when the thread exits, and dropped when the pool
+ *  is destroyed. without ELR_USE_THREAD it is the same as elr_mpl_create.
+ */
+ELR_MPL_API elr_mpl_t elr_mpl_create_cached(elr_mpl_ht fpool,
+	size_t obj_size,
+	size_t cache_size,
+	elr_mpl_callback on_alloc,
+	elr_mpl_callback on_free);
+
+/*
+** һڴڴأָ䵥ԪС
+** ֻдڴڵлµڴʱҪ
+*/
+/*! \brief create a memory pool with a lock-free free list.
+ *  \param fpool the parent pool of the about to created pool.
+ *  \param obj_size the size of memory block can alloc from the pool.
+ *  \param on_alloc the function that will called after memory alloced.
+ *  \param on_free the function that will called before free memory.
+ *  \retval NULL if failed.
+ *
+ *  free memory blocks are kept in a compare-and-swap stack whose head is
+ *  tagged with the tag of the top slice, so alloc and free take no lock.
+ *  nodes are only carved under the pool lock and are not given back until
+ *  the pool is destroyed. on_free is not called for memory blocks still in
+ *  use when the pool is destroyed. without ELR_USE_THREAD it is the same
+ *  as elr_mpl_create.
+ */
+ELR_MPL_API elr_mpl_t elr_mpl_create_lockfree(elr_mpl_ht fpool,
+	size_t obj_size,
+	elr_mpl_callback on_alloc,
+	elr_mpl_callback on_free);
+
+/*
+** һڵǰ̵߳ڴأָ䵥ԪС
+** ֻӵ߿Դ룬κ̶߳ͷš
+** ӵͷŲ߳ͷʱڴѹԶͷջ
+** ӵһ롢ͳʱһȡأڴ֮ǰЩڴΪá
+*/
+/*! \brief create a memory pool owned by the calling thread.
+ *  \param fpool the parent pool of the about to created pool.
+ *  \param obj_size the size of memory block can alloc from the pool.
+ *  \param on_alloc the function that will called after memory alloced.
+ *  \param on_free the function that will called before free memory.
+ *  \retval NULL if failed.
+ *
+ *  only the owner may alloc from the pool, any thread may free to it.
+ *  alloc and free on the owner take no lock. a free on another thread
+ *  pushes the memory block to a lock-free remote free list with one
+ *  compare-and-swap, and the owner takes the whole list back on its next
+ *  alloc, elr_mpl_trim or elr_mpl_stats. until then those memory blocks
+ *  count as in use and their nodes cannot be trimmed; if the owner exits,
+ *  hand the pool over with elr_mpl_set_owner and trim it on the new owner.
+ *  on_free is called by the freeing thread. trim the pool on the
+ *  owner, elr_mpl_stats on other threads counts no nodes of it. destroy
+ *  it on the owner, or when no thread uses it. on_free is not called for
+ *  memory blocks still in use when the pool is destroyed. without
+ *  ELR_USE_THREAD it is the same as elr_mpl_create.
+ */
+ELR_MPL_API elr_mpl_t elr_mpl_create_owned(elr_mpl_ht fpool,
+	size_t obj_size,
+	elr_mpl_callback on_alloc,
+	elr_mpl_callback on_free);
+
+/*
+** һCPUƬڴأָ䵥ԪС
+** ÿCPUһͬķƬʱʹõǰCPUķƬͷʱصڴķƬ
+** ǰCPUķƬûпڴʱȴƬá
+*/
+/*! \brief create a memory pool sharded by CPU.
+ *  \param fpool the parent pool of the about to created pool.
+ *  \param obj_size the size of memory block can alloc from the pool.
+ *  \param on_alloc the function that will called after memory alloced.
+ *  \param on_free the function that will called before free memory.
+ *  \retval NULL if failed.
+ *
+ *  the pool keeps one shard per CPU, each a child pool with its own lock
+ *  and free list. alloc takes from the shard of the CPU the calling thread
+ *  runs on, picked by sched_getcpu on linux and GetCurrentProcessorNumber
+ *  on windows, and free gives the memory block back to the shard it came
+ *  from. when the shard runs dry, free memory blocks of other shards are
+ *  taken before a new node is alloced, so free memory does not pile up in
+ *  idle shards. unlike thread caches, memory stays bounded by the count of
+ *  CPUs however many threads come and go. elr_mpl_stats, elr_mpl_trim and
+ *  elr_mpl_latency always include the shards. without ELR_USE_THREAD it is
+ *  the same as elr_mpl_create.
+ */
+ELR_MPL_API elr_mpl_t elr_mpl_create_sharded(elr_mpl_ht fpool,
+	size_t obj_size,
+	elr_mpl_callback on_alloc,
+	elr_mpl_callback on_free);
+
+/*
+** ǰ߳Ϊelr_mpl_create_ownedڴصӵߡ
+*/
+/*! \brief make the calling thread the owner of a pool.
+ *  \param pool  pointer to a elr_mpl_t type variable created by
+ *  elr_mpl_create_owned.
+ *
+ *  for example after the pool is created on a startup thread, or after
+ *  the owner exits. no thread may alloc from the pool during the call.
+ */
+ELR_MPL_API void elr_mpl_set_owner(elr_mpl_ht pool);
+
+/*
+** һڴ鰴ָֽڴأָ䵥ԪС
+** ʾֽ2ݡ
+*/
+/*! \brief create a memory pool whose memory blocks are aligned.
+ *  \param fpool the parent pool of the about to created pool.
+ *  \param obj_size the size of memory block can alloc from the pool.
+ *  \param align the alignment of memory blocks, must be a power of two.
+ *  \param on_alloc the function that will called after memory alloced.
+ *  \param on_free the function that will called before free memory.
+ *  \retval NULL if failed.
+ *
+ *  the slice stride is rounded up to a multiple of align and nodes are
+ *  laid out so that every memory block starts on an align boundary. with
+ *  align of the cache line size adjacent memory blocks never share a cache
+ *  line.
+ */
+ELR_MPL_API elr_mpl_t elr_mpl_create_aligned(elr_mpl_ht fpool,
+	size_t obj_size,
+	size_t align,
+	elr_mpl_callback on_alloc,
+	elr_mpl_callback on_free);
+
+/*
+** һ֧߳ͬ֡ڴ鰴ָֽڴأָ䵥ԪС
+*/
+ELR_MPL_API elr_mpl_t elr_mpl_create_aligned_sync(elr_mpl_ht fpool,
+	size_t obj_size,
+	size_t align,
+	elr_mpl_callback on_alloc,
+	elr_mpl_callback on_free);
+
+/*
+** һڴûƬͷĽڴأָ䵥ԪС
+** ڴڵ㰴С룬ͷڴʱڴַĵλҵڴڵ㡣
+*/
+/*! \brief create a memory pool whose memory blocks carry no header.
+ *  \param fpool the parent pool of the about to created pool.
+ *  \param obj_size the size of memory block can alloc from the pool.
+ *  \param on_alloc the function that will called after memory alloced.
+ *  \param on_free the function that will called before free memory.
+ *  \retval NULL if failed.
+ *
+ *  nodes are 64KB and aligned to their size, and registered in a global
+ *  address map, so elr_mpl_free and elr_mpl_size find the node of a memory
+ *  block by masking its address. free memory blocks are linked through
+ *  their own first bytes. memory blocks are aligned to the size of a
+ *  pointer. nodes are not given back until the pool is destroyed, and
+ *  on_free is not called for memory blocks still in use when the pool is
+ *  destroyed. if less than 8 memory blocks fit in a node, an ordinary pool
+ *  is created instead.
+ */
+ELR_MPL_API elr_mpl_t elr_mpl_create_compact(elr_mpl_ht fpool,
+	size_t obj_size,
+	elr_mpl_callback on_alloc,
+	elr_mpl_callback on_free);
+
+/*
+** һֵ֧߳ͬĽڴأָ䵥ԪС
+*/
+ELR_MPL_API elr_mpl_t elr_mpl_create_compact_sync(elr_mpl_ht fpool,
+	size_t obj_size,
+	elr_mpl_callback on_alloc,
+	elr_mpl_callback on_free);
+
+/*
+** һڴأָĬϵķ䵥ԪС
+** ڴصڴڴڵ˳򻮷֣ûƬͷܵͷţ
+** ֻͨelr_mpl_resetãͨelr_mpl_rewind˵elr_mpl_markµλá
+*/
+/*! \brief create an arena pool which carves memory blocks sequentially.
+ *  \param fpool the parent pool of the about to created pool.
+ *  \param obj_size the size of memory block elr_mpl_alloc returns.
+ *  \retval NULL if failed.
+ *
+ *  memory blocks carry no header and are aligned to twice the size of a
+ *  pointer. elr_mpl_free and elr_mpl_size must not be used on them; all of
+ *  them are released at once by elr_mpl_reset, or back to a position by
+ *  elr_mpl_rewind. nodes are kept for reuse until elr_mpl_trim or the pool
+ *  is destroyed.
+ */
+ELR_MPL_API elr_mpl_t elr_mpl_create_arena(elr_mpl_ht fpool, size_t obj_size);
+
+/*
+** һֵ֧߳ͬľڴأָĬϵķ䵥ԪС
+*/
+ELR_MPL_API elr_mpl_t elr_mpl_create_arena_sync(elr_mpl_ht fpool, size_t obj_size);
+
 /*
 ** Դ벻ͬСڴڴء
 ** һʾڴأΪNULLʾڴصĸڴȫڴء
@@ -164,6 +491,8 @@ ELR_MPL_API elr_mpl_t elr_mpl_create_sync(elr_mpl_ht fpool,
 ** ĸʾжٸͬСobj_size
 ** ֮int͵ĲָҪõĶobj_size
 ** obj_sizeintͣᴴʧ
+** obj_sizeӦôСУڴʱͨߴֱҵССڴء
+** obj_size밴1KBµڴأͨϣҡ
 */
 ELR_MPL_API elr_mpl_t elr_mpl_create_multi(elr_mpl_ht fpool,
 	int obj_size_count,
@@ -181,6 +510,27 @@ ELR_MPL_API elr_mpl_t elr_mpl_create_multi_sync(elr_mpl_ht fpool,
 	elr_mpl_callback on_alloc,
 	elr_mpl_callback on_free);
 
+/*
+** Դ벻ͬСڴڴأڴ鰴ָֽ롣
+** ĳߴ糬obj_sizeʱ´ڴҲֽͬ롣
+*/
+ELR_MPL_API elr_mpl_t elr_mpl_create_multi_aligned(elr_mpl_ht fpool,
+	int obj_size_count,
+	size_t* obj_size,
+	size_t align,
+	elr_mpl_callback on_alloc,
+	elr_mpl_callback on_free);
+
+/*
+** Դ벻ͬСڴĲ֧߳ͬڴأڴ鰴ָֽ롣
+*/
+ELR_MPL_API elr_mpl_t elr_mpl_create_multi_aligned_sync(elr_mpl_ht fpool,
+	int obj_size_count,
+	size_t* obj_size,
+	size_t align,
+	elr_mpl_callback on_alloc,
+	elr_mpl_callback on_free);
+
 
 /*
 ** жڴǷЧģһڴɺá
@@ -193,6 +543,23 @@ ELR_MPL_API elr_mpl_t elr_mpl_create_multi_sync(elr_mpl_ht fpool,
  */
 ELR_MPL_API int  elr_mpl_avail(elr_mpl_ht pool);
 
+/*
+** ȡһʹʱڴأģÿγʼһεʱcreate
+** ߳ͬʱʱֻһΣʧܻģδʼʱNULL´εʱԡ
+*/
+/*! \brief get a memory pool created on first use.
+ *  \param lazy  pointer to a elr_mpl_lazy_t type variable.
+ *  \param create  creates the memory pool.
+ *  \param arg  argument of create.
+ *  \retval the memory pool, NULL if the module is not initialized or create failed.
+ *
+ *  the pool is created by the first call after each elr_mpl_init that
+ *  initializes the module, so a pool destroyed by elr_mpl_finalize is
+ *  never handed out. create runs once even if many threads call at once.
+ *  a failed create is retried by the next call.
+ */
+ELR_MPL_API elr_mpl_ht elr_mpl_lazy(elr_mpl_lazy_t* lazy, elr_mpl_factory create, void* arg);
+
 /*
 ** ڴڴ棬СΪڴصķ䵥ԪС
 ** poolΪNULL
@@ -212,6 +579,326 @@ ELR_MPL_API void* elr_mpl_alloc(elr_mpl_ht pool);
 */
 ELR_MPL_API void* elr_mpl_alloc_multi(elr_mpl_ht pool, size_t size);
 
+/*
+** ڴڴ棬СΪڴصķ䵥ԪС
+** ֻͨ÷ڴű֤㣬on_allocִ֮С
+** poolΪNULL
+*/
+/*! \brief alloc a zeroed memory block from a memory pool.
+ *  \param pool  pointer to a elr_mpl_t type variable.
+ *  \retval NULL if failed.
+ *
+ *  memory blocks from elr_mpl_alloc are not zeroed, not even the first
+ *  time. on_alloc is called after zeroing. blocks of 64KB or more are
+ *  zeroed with non-temporal stores where SSE2 is available.
+ */
+ELR_MPL_API void* elr_mpl_calloc(elr_mpl_ht pool);
+
+/*
+** ڴָСڴ档
+** poolΪNULLʱȫڴ
+*/
+ELR_MPL_API void* elr_mpl_calloc_multi(elr_mpl_ht pool, size_t size);
+
+/*
+** ıӶߴڴڴĴСݱ¾ɴСнСһ
+** ڴڵڴµĴСʱԭطأpool롣
+** ڴСʱڴ棬СڴֵʱƵӦߴڴء
+** poolΪNULLʱʹȫڴ
+*/
+/*! \brief resize a memory block alloced by elr_mpl_alloc_multi.
+ *  \param pool  the multi pool the memory block came from, NULL for the global one.
+ *  \param mem   the memory block, NULL to alloc a new one.
+ *  \param size  the new size, zero to free the memory block.
+ *  \retval NULL if failed, the memory block is left untouched then.
+ *
+ *  the memory block is returned as is when its size class still holds
+ *  size bytes. on linux large memory blocks grow with mremap, in place
+ *  when the address space after them is free, without copying otherwise.
+ *  a large memory block shrunk below the large threshold moves to its
+ *  size class. one that stays large gives its surplus pages back with
+ *  mremap on linux, and moves when shrunk below half elsewhere.
+ */
+ELR_MPL_API void* elr_mpl_realloc_multi(elr_mpl_ht pool, void* mem, size_t size);
+
+/*
+** ӾڴָСڴ档
+** poolΪNULL
+*/
+/*! \brief alloc a memory block of any size from an arena pool.
+ *  \param pool  pointer to an arena pool.
+ *  \param size  bytes of the memory block.
+ *  \retval NULL if failed.
+ */
+ELR_MPL_API void* elr_mpl_alloc_arena(elr_mpl_ht pool, size_t size);
+
+/*
+** þڴأ֮ǰڴȫϣڴڵ㱣»֡
+*/
+/*! \brief release all memory blocks of an arena pool at once.
+ *  \param pool  pointer to an arena pool.
+ *
+ *  costs one step per node used. nodes are kept. all marks taken
+ *  before are invalidated.
+ */
+ELR_MPL_API void elr_mpl_reset(elr_mpl_ht pool);
+
+/*
+** ¾ڴصǰĻλá
+*/
+/*! \brief save the current position of an arena pool.
+ *  \param pool  pointer to an arena pool.
+ *  \param mark  receives the position.
+ */
+ELR_MPL_API void elr_mpl_mark(elr_mpl_ht pool, elr_mpl_mark_t* mark);
+
+/*
+** ڴػ˵markµλã֮ڴȫϡ
+** ǿǶף˵ǺڲʧЧ
+*/
+/*! \brief release memory blocks alloced from an arena pool since a mark.
+ *  \param pool  pointer to an arena pool.
+ *  \param mark  a position saved by elr_mpl_mark.
+ *
+ *  marks nest: rewinding to a mark invalidates marks taken after it.
+ */
+ELR_MPL_API void elr_mpl_rewind(elr_mpl_ht pool, const elr_mpl_mark_t* mark);
+
+/*
+** ڴصڴڵǷʹ2MBҳֻڴһڴڵ֮ǰá
+** Զߴڴʱеڴء
+** 0ʾʧܡ
+*/
+/*! \brief back the nodes of a memory pool with 2MB huge pages.
+ *  \param pool  pointer to a elr_mpl_t type variable.
+ *  \param enable non-zero to use huge pages.
+ *  \retval zero if the pool already has nodes, or is a compact pool.
+ *
+ *  nodes are sized to fill whole huge pages and mapped at huge page
+ *  alignment. on linux MAP_HUGETLB is tried first, then an aligned mapping
+ *  advised with MADV_HUGEPAGE for transparent huge pages. on windows
+ *  MEM_LARGE_PAGES is tried first. when huge pages are not available the
+ *  nodes are ordinary mappings of the same size.
+ */
+ELR_MPL_API int elr_mpl_set_huge_page(elr_mpl_ht pool, int enable);
+
+/*
+** ȡߴڴиڴصڲƬͳƣǸߴ磬ǰߴеĳΧڴء
+** poolΪNULLʱȡȫֶߴڴصͳơ
+*/
+/*! \brief report internal fragmentation of each class of a multi pool.
+ *  \param pool  pointer to a multi pool, NULL for the global one.
+ *  \param stats array to receive one entry per class.
+ *  \param capacity count of elements of stats.
+ *  \retval count of classes, which may exceed capacity.
+ *
+ *  the declared classes come first in order, then the pools created for
+ *  sizes above them, sorted by size. large memory blocks are not counted.
+ */
+ELR_MPL_API int elr_mpl_class_stats(elr_mpl_ht pool, elr_mpl_class_stats_t* stats, int capacity);
+
+/*
+** ʼֹͣ¼ߴڴصߴֱͼpoolΪNULLʱȫֶߴڴء
+** ֱͼ8ֽڣΧ64KBΧ벻ߴļ㡣
+** 0ʾڴ治㡣
+*/
+/*! \brief start or stop recording requested sizes of a multi pool.
+ *  \param pool  pointer to a multi pool, NULL for the global one.
+ *  \param enable non-zero to record.
+ *  \retval zero if the histogram can not be alloced.
+ *
+ *  the histogram has 8 byte buckets up to 64KB and is kept when recording
+ *  stops, until the pool is destroyed. recording costs one atomic increment
+ *  per elr_mpl_alloc_multi.
+ */
+ELR_MPL_API int elr_mpl_set_profiling(elr_mpl_ht pool, int enable);
+
+/*
+** ߴڴصߴֱͼ
+*/
+ELR_MPL_API void elr_mpl_profile_reset(elr_mpl_ht pool);
+
+/*
+** ݼ¼ߴֱͼ㲻max_countߴĳߴʹռõֽ١
+** سߴĸߴСУûм¼ʱ0
+*/
+/*! \brief suggest size classes for the recorded requested sizes.
+ *  \param pool  pointer to a multi pool, NULL for the global one.
+ *  \param max_count the most classes wanted.
+ *  \param obj_size array of max_count elements to receive the classes.
+ *  \retval count of classes, zero if nothing recorded.
+ *
+ *  the classes minimize the bytes handed out for the recorded requests.
+ *  costs time quadratic in the count of distinct 8 byte buckets seen.
+ *  feed the result to elr_mpl_init_ex or elr_mpl_create_multi.
+ */
+ELR_MPL_API int elr_mpl_suggest_classes(elr_mpl_ht pool, int max_count, size_t* obj_size);
+
+/*
+** ߴ浽ıļУÿһߴ硣0ʾʧܡ
+*/
+ELR_MPL_API int elr_mpl_save_classes(const char* path, int obj_size_count, const size_t* obj_size);
+
+/*
+** elr_mpl_save_classesıļжȡߴ#ͷע͡
+** ضȡĳߴļڡʽ󡢳ߴûдСл򳬹capacityʱ0
+*/
+ELR_MPL_API int elr_mpl_load_classes(const char* path, size_t* obj_size, int capacity);
+
+/*
+** öѲĲʣƽÿrateֽڲһڴ鲢¼ջΪ0ʱֹͣ
+** ҪELR_USE_SAMPLING룬򷵻0
+*/
+/*! \brief set the heap sampling rate.
+ *  \param rate mean bytes allocated between two samples, 0 to stop sampling.
+ *  \retval zero if sampling is not compiled in.
+ *
+ *  sampled memory blocks keep their call stack until freed.
+ *  memory blocks of compact and arena pools are never sampled.
+ *  requires compiling with ELR_USE_SAMPLING.
+ */
+ELR_MPL_API int elr_mpl_set_sampling(size_t rate);
+
+/*
+** õĲڴ鰴ջܣpprofľɰʽдļ0ʾʧܡ
+*/
+/*! \brief write sampled live memory blocks as a pprof heap profile.
+ *  \param path file to write.
+ *  \retval zero on failure or if sampling is not compiled in.
+ *
+ *  read with pprof <program> <path>, sizes are scaled by the sampling rate.
+ */
+ELR_MPL_API int elr_mpl_heap_dump(const char* path);
+
+/*
+** ڴǷάڴֻڴûڴʱá
+** ֻڴʱʹõڴִon_freeĬָֻon_freeʱά
+** Զߴڴʱеڴء
+** 0ʾʧܡ
+*/
+/*! \brief choose whether a memory pool keeps a list of memory blocks in use.
+ *  \param pool  pointer to a elr_mpl_t type variable.
+ *  \param enable non-zero to keep the list.
+ *  \retval zero if the pool has memory blocks in use, or never keeps the list.
+ *
+ *  the list only lets elr_mpl_destroy call on_free for memory blocks still
+ *  in use, and is kept by default only when on_free is given. without it
+ *  alloc and free touch no other memory block. lock-free, owned, compact
+ *  and arena pools never keep it.
+ */
+ELR_MPL_API int elr_mpl_set_tracking(elr_mpl_ht pool, int enable);
+
+/*
+** ڴرڴڵĲԣԶߴڴʱеڴء
+** ڴڵ㳬highʱͷŵֻʣlow
+** ûʱڴռõڴ泬512MBͷſڴڵ㡣
+*/
+/*! \brief set how many empty nodes a memory pool keeps.
+ *  \param pool  pointer to a elr_mpl_t type variable.
+ *  \param low the count of empty nodes kept after releasing.
+ *  \param high the count of empty nodes that triggers releasing.
+ *
+ *  when a node becomes empty and the pool has more than high empty nodes,
+ *  empty nodes are given back to the system until low are left. the gap
+ *  between low and high keeps nodes from churning. without a policy, empty
+ *  nodes are only given back while the pools occupy more than 512MB.
+ *  compact and lock-free pools never give back nodes.
+ */
+ELR_MPL_API void elr_mpl_set_retention(elr_mpl_ht pool, size_t low, size_t high);
+
+/*
+** ͷڴصпڴڵ㣬recursiveΪ0ʱҲͷڴصĿڴڵ㡣
+** ͷŵֽ
+*/
+/*! \brief give back all empty nodes of a memory pool to the system.
+ *  \param pool  pointer to a elr_mpl_t type variable.
+ *  \param recursive non-zero to trim child pools too.
+ *  \retval bytes given back.
+ *
+ *  cached mappings of large memory blocks are unmapped too. memory blocks
+ *  kept in thread caches count as in use. do not destroy pools of the tree
+ *  while it is trimmed.
+ */
+ELR_MPL_API size_t elr_mpl_trim(elr_mpl_ht pool, int recursive);
+
+/*
+** ȡڴصͳݣrecursiveΪ0ʱۼڴصͳݡ
+** poolΪNULLʱͳڴأߴڴصͳưеڴء
+*/
+/*! \brief get statistics of a memory pool.
+ *  \param pool  pointer to a elr_mpl_t type variable, NULL for all pools.
+ *  \param stats pointer to the statistics to be filled.
+ *  \param recursive non-zero to sum up child pools too.
+ *
+ *  counters are updated under the pool lock that is taken anyway, by the
+ *  owner thread of a thread cache, or with atomics for lock-free pools, so
+ *  they are always on. do not destroy pools of the tree while it is
+ *  walked.
+ */
+ELR_MPL_API void elr_mpl_stats(elr_mpl_ht pool, elr_mpl_stats_t* stats, int recursive);
+
+/*
+** ȡڴkindӳٵİٷλλ룬ҪELR_USE_HISTOGRAM롣
+** ÿڴذ2ݷͰ¼롢ͷšڴڵ͵ȴӳ١
+** poolΪNULLʱͳڴأߴڴصͳưеڴء
+*/
+/*! \brief get a percentile of the latency of a memory pool.
+ *  \param pool  pointer to a elr_mpl_t type variable, NULL for all pools.
+ *  \param kind one of ELR_MPL_LATENCY_ALLOC, ELR_MPL_LATENCY_FREE,
+ *  ELR_MPL_LATENCY_REFILL and ELR_MPL_LATENCY_LOCK.
+ *  \param percentile the percentile wanted, 99 for p99.
+ *  \param recursive non-zero to sum up child pools too.
+ *  \retval the latency in nanoseconds, 0 if nothing was recorded.
+ *
+ *  latencies are only recorded when the library is compiled with
+ *  ELR_USE_HISTOGRAM, otherwise this function always returns 0. each pool
+ *  keeps a histogram per kind with power of two buckets of nanoseconds, so
+ *  the result is interpolated within a bucket and can be off by up to a
+ *  factor of two. batch calls are not recorded, except for their lock waits
+ *  and refills. do not destroy pools of the tree while it is walked.
+ */
+ELR_MPL_API double elr_mpl_latency(elr_mpl_ht pool, int kind, double percentile, int recursive);
+
+/*
+** ڴصӳֱͼrecursiveΪ0ʱҲڴصġ
+*/
+/*! \brief clear the latency histograms of a memory pool.
+ *  \param pool  pointer to a elr_mpl_t type variable, NULL for all pools.
+ *  \param recursive non-zero to clear child pools too.
+ *
+ *  samples recorded by other threads during the call may be lost.
+ */
+ELR_MPL_API void elr_mpl_latency_reset(elr_mpl_ht pool, int recursive);
+
+/*
+** öߴڴصĴڴֵpoolΪNULLʱȫֶߴڴء
+** obj_sizeҲСֱֵӳڴҳĬֵΪ32KB0ʾʹá
+*/
+/*! \brief set the size from which a multi pool maps memory blocks directly.
+ *  \param pool  pointer to a elr_mpl_t type variable created by
+ *  elr_mpl_create_multi, NULL for the global multi pool.
+ *  \param size the threshold, 0 to disable. the default is 32KB.
+ *
+ *  a request larger than all obj_size and not less than size gets its own
+ *  page aligned mapping instead of a slice of a 1KB rounded child pool.
+ *  up to 8 freed mappings are kept for reuse by size, their pages are given
+ *  back to the system with madvise. elr_mpl_size returns the usable size
+ *  of the mapping, which may exceed the requested size.
+ */
+ELR_MPL_API void elr_mpl_set_large_size(elr_mpl_ht pool, size_t size);
+
+/*
+** ڴnڴ飬mem飬ʵ뵽
+** ֻһΣûпڴʱڴڵ֡
+*/
+/*! \brief alloc memory blocks from a memory pool in one go.
+ *  \param pool  pointer to a elr_mpl_t type variable.
+ *  \param n the count of memory blocks to alloc.
+ *  \param mem array to receive the memory blocks, at least n elements.
+ *  \retval the count of memory blocks alloced, less than n if failed.
+ */
+ELR_MPL_API size_t elr_mpl_alloc_batch(elr_mpl_ht pool, size_t n, void** mem);
+
 /*
 ** ȡڴڴĳߴ硣
 */
@@ -228,6 +915,21 @@ ELR_MPL_API size_t elr_mpl_size(void* mem);
  */
 ELR_MPL_API void elr_mpl_free(void* mem);
 
+/*
+** ڴ˻ظڴأڴԲͬڴء
+** ͬһڴصڴֻһΣͬһڴڵڴһι黹
+*/
+/*! \brief give back memory blocks to their memory pools in one go.
+ *  \param mem array of memory blocks.
+ *  \param n the count of memory blocks.
+ *
+ *  adjacent memory blocks of the same pool are given back under one lock,
+ *  and adjacent memory blocks of the same node are spliced in one step.
+ *  so keep memory blocks of the same pool together, for example in the
+ *  order they were alloced by elr_mpl_alloc_batch.
+ */
+ELR_MPL_API void elr_mpl_free_batch(void** mem, size_t n);
+
 /*
 ** ڴغڴء
 */
@@ -0,0 +1,199 @@
+/*! \file elr_mpl_allocator.hpp.
+ *  \brief std::allocator compatible allocator over the memory pool.
+ *
+ *  node based containers such as std::list, std::map and
+ *  std::unordered_map allocate one node at a time. elr_mpl_allocator
+ *  serves those single object allocations from a fixed size memory pool,
+ *  one pool for each sizeof(T) and alignof(T) the allocator is rebound to,
+ *  and array allocations from a multi size memory pool aligned to at least
+ *  alignof(max_align_t), one pool for each alignment.
+ *
+ *      std::map<int, int, std::less<int>,
+ *          elr_mpl_allocator<std::pair<const int, int> > > m;
+ *
+ *  elr_mpl_init must be called before the first allocation and all
+ *  containers using the allocator must be cleared before the last
+ *  elr_mpl_finalize, which destroys the pools. the pools are created
+ *  again on first use after the module is initialized again.
+ */
+
+#ifndef __ELR_MPL_ALLOCATOR_HPP__
+#define __ELR_MPL_ALLOCATOR_HPP__
+
+#include <cstddef>
+#include <new>
+#include "elr_mpl.h"
+
+/*C++11֮ǰûalignofstd::max_align_tñչͻ͵ϴ*/
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1900)
+#define ELR_MPL_ALIGNOF(T)    alignof(T)
+typedef std::max_align_t      elr_mpl_max_align_t;
+#else
+#if defined(_MSC_VER)
+#define ELR_MPL_ALIGNOF(T)    __alignof(T)
+#else
+#define ELR_MPL_ALIGNOF(T)    __alignof__(T)
+#endif
+union elr_mpl_max_align_t
+{
+	long double  ld;
+	long long    ll;
+	double       d;
+	void        *p;
+};
+#endif
+
+/*
+** ÿֶСͶֽӦһڴأģÿγʼڵһʹʱ
+** elr_mpl_lazy_tǾ̬ʼģC++11֮ǰıҲ̰߳ȫġ
+*/
+/*! \brief fixed size memory pool shared by allocators of the same
+ *  sizeof(T) and alignof(T).
+ */
+template <std::size_t Size, std::size_t Align>
+struct elr_mpl_size_pool
+{
+	static elr_mpl_ht get()
+	{
+		static elr_mpl_lazy_t pool;
+		return elr_mpl_lazy(&pool, create, NULL);
+	}
+
+private:
+	static elr_mpl_t create(void*)
+	{
+#ifdef ELR_USE_THREAD
+		return elr_mpl_create_aligned_sync(NULL, Size, Align, NULL, NULL);
+#else
+		return elr_mpl_create_aligned(NULL, Size, Align, NULL, NULL);
+#endif // ELR_USE_THREAD
+	}
+};
+
+/*
+** ӰֽͬĶߴڴ룬ߴȫֶߴڴصĬϳߴͬ
+** ȫֶߴڴֻint룬ԪصĶҪ
+*/
+/*! \brief multi size memory pool shared by array allocations of the same
+ *  alignment.
+ */
+template <std::size_t Align>
+struct elr_mpl_array_pool
+{
+	static elr_mpl_ht get()
+	{
+		static elr_mpl_lazy_t pool;
+		return elr_mpl_lazy(&pool, create, NULL);
+	}
+
+private:
+	static elr_mpl_t create(void*)
+	{
+		std::size_t obj_size[12] = { 64, 128, 192, 256, 384, 512, 768, 1024, 1280, 1536, 1792, 2048 };
+
+#ifdef ELR_USE_THREAD
+		return elr_mpl_create_multi_aligned_sync(NULL, 12, obj_size, Align, NULL, NULL);
+#else
+		return elr_mpl_create_multi_aligned(NULL, 12, obj_size, Align, NULL, NULL);
+#endif // ELR_USE_THREAD
+	}
+};
+
+/*
+** ӶӦСڴ룬ӶĶߴڴ룬
+** alignof(T)alignof(max_align_t)нϴĶ롣
+** ͷʱͳһelr_mpl_freeڴ¼ڴء
+*/
+/*! \brief std::allocator compatible allocator over the memory pool.
+ *
+ *  all instances are interchangeable, memory allocated by one instance
+ *  can be deallocated by any other, whatever type it is rebound to.
+ */
+template <typename T>
+class elr_mpl_allocator
+{
+public:
+	typedef T                 value_type;
+	typedef T*                pointer;
+	typedef const T*          const_pointer;
+	typedef T&                reference;
+	typedef const T&          const_reference;
+	typedef std::size_t       size_type;
+	typedef std::ptrdiff_t    difference_type;
+
+	template <typename U>
+	struct rebind
+	{
+		typedef elr_mpl_allocator<U> other;
+	};
+
+	elr_mpl_allocator() throw() {}
+	elr_mpl_allocator(const elr_mpl_allocator&) throw() {}
+	template <typename U>
+	elr_mpl_allocator(const elr_mpl_allocator<U>&) throw() {}
+
+	pointer address(reference x) const { return &x; }
+	const_pointer address(const_reference x) const { return &x; }
+
+	pointer allocate(size_type n, const void* hint = 0)
+	{
+		elr_mpl_ht pool = NULL;
+		void* mem = NULL;
+
+		(void)hint;
+		if (n > max_size())
+			throw std::bad_alloc();
+
+		/*ģδʼ򴴽ڴʧʱڴΪNULL*/
+		if (n == 1)
+		{
+			if ((pool = elr_mpl_size_pool<sizeof(T), align>::get()) != NULL)
+				mem = elr_mpl_alloc(pool);
+		}
+		else
+		{
+			if ((pool = elr_mpl_array_pool<array_align>::get()) != NULL)
+				mem = elr_mpl_alloc_multi(pool, n == 0 ? 1 : n * sizeof(T));
+		}
+
+		if (mem == NULL)
+			throw std::bad_alloc();
+		return static_cast<pointer>(mem);
+	}
+
+	void deallocate(pointer p, size_type)
+	{
+		if (p != NULL)
+			elr_mpl_free(p);
+	}
+
+	size_type max_size() const throw()
+	{
+		return static_cast<size_type>(-1) / sizeof(T);
+	}
+
+	void construct(pointer p, const T& val) { new (static_cast<void*>(p)) T(val); }
+	void destroy(pointer p) { p->~T(); }
+
+private:
+	enum
+	{
+		align = ELR_MPL_ALIGNOF(T),
+		array_align = ELR_MPL_ALIGNOF(T) > ELR_MPL_ALIGNOF(elr_mpl_max_align_t)
+			? ELR_MPL_ALIGNOF(T) : ELR_MPL_ALIGNOF(elr_mpl_max_align_t)
+	};
+};
+
+template <typename T, typename U>
+inline bool operator==(const elr_mpl_allocator<T>&, const elr_mpl_allocator<U>&)
+{
+	return true;
+}
+
+template <typename T, typename U>
+inline bool operator!=(const elr_mpl_allocator<T>&, const elr_mpl_allocator<U>&)
+{
+	return false;
+}
+
+#endif // __ELR_MPL_ALLOCATOR_HPP__
@@ -24,12 +24,97 @@ typedef volatile LONG         elr_atomic_t;
 
 /** platform independent counter integer type. */
 typedef LONG                  elr_counter_t;   
+
+/** platform independent 64 bit atomic counter type. */
+typedef volatile LONG64       elr_atomic64_t;
+
+/** platform independent 64 bit counter integer type. */
+typedef LONG64                elr_counter64_t;
  
 /** platform independent zero initial value of atomic counter type. */
 #define   ELR_ATOMIC_ZERO     0
 
+/** platform independent atomic pointer type. */
+typedef PVOID volatile        elr_atomic_ptr;
+
+/** platform independent thread local storage key type. */
+typedef DWORD                 elr_tls_t;
+
+/** calling convention of the thread exit callback of thread local storage. */
+#define   ELR_TLS_CALLBACK    WINAPI
+
+/** alignment required by double word compare-and-swap. */
+#ifdef _WIN64
+#define   ELR_TAGGED_ALIGN    __declspec(align(16))
+#else
+#define   ELR_TAGGED_ALIGN    __declspec(align(8))
+#endif
+
+#elif defined(__linux__)
+#include <stddef.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+/*! \brief platform independent mutex type.
+ *
+ *  an adaptive lock built on c11 atomics and futex. it spins a while
+ *  before sleeping on the futex, the spin count adapts to how long the
+ *  lock was held recently. like the windows critical section, it can be
+ *  locked recursively by the thread owning it.
+ */
+typedef struct __elr_mtx
+{
+	atomic_int        _state; /*!< 0 unlocked, 1 locked, 2 locked and maybe waited. */
+	atomic_ulong      _owner; /*!< the thread owning the lock, 0 if none. */
+	int               _count; /*!< recursion count of the owner. */
+	atomic_int        _spins; /*!< the average spin count to get the lock. */
+}
+elr_mtx;
+
+/** platform independent atomic counter type. */
+typedef atomic_long           elr_atomic_t;
+
+/** platform independent counter integer type. */
+typedef long                  elr_counter_t;
+
+/** platform independent 64 bit atomic counter type. */
+typedef atomic_llong          elr_atomic64_t;
+
+/** platform independent 64 bit counter integer type. */
+typedef long long             elr_counter64_t;
+
+/** platform independent zero initial value of atomic counter type. */
+#define   ELR_ATOMIC_ZERO     0
+
+/** platform independent atomic pointer type. */
+typedef _Atomic(void*)        elr_atomic_ptr;
+
+/** platform independent thread local storage key type. */
+typedef pthread_key_t         elr_tls_t;
+
+/** calling convention of the thread exit callback of thread local storage. */
+#define   ELR_TLS_CALLBACK
+
+/** alignment required by double word compare-and-swap. */
+#define   ELR_TAGGED_ALIGN    __attribute__((aligned(2 * sizeof(void*))))
+
 #endif
 
+/*! \brief pointer with a tag, swapped as a whole.
+ *
+ *  the tag must change whenever the same pointer is stored again,
+ *  so a compare-and-swap does not succeed on a recycled pointer.
+ */
+typedef struct ELR_TAGGED_ALIGN __elr_tagged_ptr
+{
+	void*         ptr; /*!< the pointer. */
+	size_t        tag; /*!< the tag of the pointer. */
+}
+elr_tagged_ptr;
+
+/** thread exit callback type of thread local storage. */
+typedef void (ELR_TLS_CALLBACK *elr_tls_callback)(void*);
+
 /*
 ** ԭ
 */
@@ -52,6 +137,155 @@ elr_counter_t elr_atomic_inc(elr_atomic_t* v);
  */
 elr_counter_t elr_atomic_dec(elr_atomic_t* v);
 
+/*
+** ԭӼӷ
+*/
+/*! \brief atomic add operation.
+ *  \param v pointer to a atomic counter type variable.
+ *  \param n the value to be added.
+ *  \retval the integer value of v after addition.
+ */
+elr_counter_t elr_atomic_add(elr_atomic_t* v, elr_counter_t n);
+
+/*
+** ԭӶȡ
+*/
+/*! \brief atomic load operation.
+ *  \param v pointer to a atomic counter type variable.
+ *  \retval the integer value of v.
+ */
+elr_counter_t elr_atomic_load(elr_atomic_t* v);
+
+/*
+** 64λԭڿܳ2^31ļ
+*/
+/*! \brief 64 bit atomic increment operation.
+ *  \param v pointer to a 64 bit atomic counter type variable.
+ *  \retval the integer value of v after increment.
+ */
+elr_counter64_t elr_atomic_inc64(elr_atomic64_t* v);
+
+/*
+** 64λԭӼӷ
+*/
+/*! \brief 64 bit atomic add operation.
+ *  \param v pointer to a 64 bit atomic counter type variable.
+ *  \param n the value to be added.
+ *  \retval the integer value of v after addition.
+ */
+elr_counter64_t elr_atomic_add64(elr_atomic64_t* v, elr_counter64_t n);
+
+/*
+** 64λԭӶȡ
+*/
+/*! \brief 64 bit atomic load operation.
+ *  \param v pointer to a 64 bit atomic counter type variable.
+ *  \retval the integer value of v.
+ */
+elr_counter64_t elr_atomic_load64(elr_atomic64_t* v);
+
+/*
+** ԭӶȡָ
+*/
+/*! \brief atomic load of a pointer.
+ *  \param src pointer to a atomic pointer type variable.
+ *  \retval the pointer, with acquire semantics.
+ */
+void* elr_atomic_load_ptr(elr_atomic_ptr* src);
+
+/*
+** ԭӽָ룬ԭֵ
+*/
+/*! \brief atomic exchange of a pointer.
+ *  \param dst pointer to a atomic pointer type variable.
+ *  \param val the pointer to be stored.
+ *  \retval the pointer stored before.
+ */
+void* elr_atomic_xchg_ptr(elr_atomic_ptr* dst, void* val);
+
+/*
+** ԭӱȽϽָ룬ɹط0
+** ʧʱexpectedΪdstĵǰֵ
+*/
+/*! \brief atomic compare-and-swap of a pointer.
+ *  \param dst pointer to a atomic pointer type variable.
+ *  \param expected pointer to the expected value, updated to the current value of dst if failed.
+ *  \param desired the pointer to be stored.
+ *  \retval zero if the current value of dst is not the expected value.
+ */
+int elr_atomic_cas_ptr(elr_atomic_ptr* dst, void** expected, void* desired);
+
+/*
+** ԭӱȽϽǩָ룬ɹط0
+** ʧʱexpectedΪdstĵǰֵ
+*/
+/*! \brief atomic compare-and-swap of a tagged pointer.
+ *  \param dst pointer to the tagged pointer to be swapped.
+ *  \param expected pointer to the expected value, updated to the current value of dst if failed.
+ *  \param desired the value to be stored.
+ *  \retval zero if the current value of dst is not the expected value.
+ */
+int elr_atomic_cas_tagged(volatile elr_tagged_ptr* dst,
+	elr_tagged_ptr* expected,
+	elr_tagged_ptr desired);
+
+/*
+** ԭӶȡǩָ룬ָͱǩֱȡ
+** ܲͬһʱ̵ֵıȽϽ
+*/
+/*! \brief atomic load of a tagged pointer.
+ *  \param src pointer to the tagged pointer to be loaded.
+ *  \param val receives the pointer with acquire ordering and the tag.
+ *
+ *  the pointer and the tag are loaded one by one, they may be torn,
+ *  which makes the following compare-and-swap fail.
+ */
+void elr_atomic_load_tagged(volatile elr_tagged_ptr* src, elr_tagged_ptr* val);
+
+/*
+** ԭӶȡ߳ͬʱ޸ĵָͨ
+*/
+/*! \brief atomic load of a plain pointer variable written by other threads.
+ *  \param src pointer to the pointer variable.
+ *  \retval the pointer, loaded with acquire ordering.
+ */
+void* elr_atomic_load_word(void* volatile* src);
+
+/*
+** ԭд뱻߳ͬʱȡָͨ
+*/
+/*! \brief atomic store of a plain pointer variable read by other threads.
+ *  \param dst pointer to the pointer variable.
+ *  \param val the pointer to be stored with release ordering.
+ */
+void elr_atomic_store_word(void* volatile* dst, void* val);
+
+/*
+** ԭӶȡ߳ͬʱ޸ĵͨ
+*/
+/*! \brief atomic load of a plain integer variable written by other threads.
+ *  \param src pointer to the integer variable.
+ *  \retval the integer value, loaded with acquire ordering.
+ */
+int elr_atomic_load_int(volatile int* src);
+
+/*
+** ԭд뱻߳ͬʱȡͨ
+*/
+/*! \brief atomic store of a plain integer variable read by other threads.
+ *  \param dst pointer to the integer variable.
+ *  \param val the integer value to be stored with release ordering.
+ */
+void elr_atomic_store_int(volatile int* dst, int val);
+
+/*
+** ȡǰ̵߳ıʶ0
+*/
+/*! \brief get the identity of the calling thread.
+ *  \retval a non-zero value unique among running threads.
+ */
+unsigned long elr_thread_self();
+
 /*
 ** ʼ壬0ʾʼʧ
 ** ʼʧܾͲҪٵelr_mtx_finalize
@@ -77,4 +311,33 @@ void elr_mtx_unlock(elr_mtx *mtx);
  */
 void elr_mtx_finalize(elr_mtx *mtx);
 
+/*
+** ʼֲ߳̾洢0ʾʼʧ
+** on_exit߳˳ʱԸ̵߳Ĵ洢ֵΪã洢ֵΪNULLʱ
+*/
+/*! \brief initialize a thread local storage key.
+ *  \param key pointer to a thread local storage key.
+ *  \param on_exit the function called with the thread`s value when a thread exits.
+ *  \retval zero if failed.
+ */
+int   elr_tls_init(elr_tls_t *key, elr_tls_callback on_exit);
+
+/*! \brief get the value of calling thread.
+ *  \param key pointer to a thread local storage key.
+ *  \retval NULL if no value was set by calling thread.
+ */
+void* elr_tls_get(elr_tls_t *key);
+
+/*! \brief set the value of calling thread.
+ *  \param key pointer to a thread local storage key.
+ *  \param val the value.
+ *  \retval zero if failed.
+ */
+int   elr_tls_set(elr_tls_t *key, void* val);
+
+/*! \brief finalize a thread local storage key.
+ *  \param key pointer to a thread local storage key.
+ */
+void  elr_tls_finalize(elr_tls_t *key);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,142 @@
+/*! \file elr_object_pool.hpp.
+ *  \brief typed object pool over the memory pool, requires C++11.
+ *
+ *  elr_object_pool<T> constructs objects in memory blocks of its own
+ *  memory pool and hands them out as std::unique_ptr whose deleter gives
+ *  the memory block back to the pool. destructors run in the on_slice_free
+ *  callback of the pool, so destroying the pool also destroys every object
+ *  still alive in it.
+ *
+ *      elr_object_pool<connection> pool;
+ *      elr_object_pool<connection>::pointer conn = pool.make(fd, addr);
+ *
+ *  elr_mpl_init must be called before the first object pool is created.
+ *  handles must not outlive their object pool.
+ */
+
+#ifndef __ELR_OBJECT_POOL_HPP__
+#define __ELR_OBJECT_POOL_HPP__
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "elr_mpl.h"
+
+/*
+** ͻĶأڴСͶֽǱڳ
+** ڴصon_slice_freeصִУڴʱʹõĶһ
+** ƽͲעصڴҲͲάõڴƬ
+*/
+/*! \brief typed object pool with RAII handles.
+ */
+template <typename T>
+class elr_object_pool
+{
+public:
+	/*! \brief deleter of handles, gives the object back to its pool.
+	 */
+	struct deleter
+	{
+		void operator()(T* obj) const
+		{
+			if (obj != NULL)
+				elr_mpl_free(obj);
+		}
+	};
+
+	typedef std::unique_ptr<T, deleter> pointer;
+
+	/*
+	** أfpoolָڴأΪNULLʱڴΪȫڴء
+	** ڴشʧʱ׳std::bad_alloc
+	*/
+	/*! \brief create an object pool.
+	 *  \param fpool the parent pool, NULL for the global memory pool.
+	 */
+	explicit elr_object_pool(elr_mpl_ht fpool = NULL)
+	{
+#ifdef ELR_USE_THREAD
+		pool_ = elr_mpl_create_aligned_sync(fpool, sizeof(T), alignof(T), NULL, on_free());
+#else
+		pool_ = elr_mpl_create_aligned(fpool, sizeof(T), alignof(T), NULL, on_free());
+#endif // ELR_USE_THREAD
+		if (pool_.pool == NULL)
+			throw std::bad_alloc();
+	}
+
+	/*
+	** ٶأʹõĶ
+	** ڴѾʱ֮ظ١
+	*/
+	~elr_object_pool()
+	{
+		if (elr_mpl_avail(&pool_) != 0)
+			elr_mpl_destroy(&pool_);
+	}
+
+	elr_object_pool(const elr_object_pool&) = delete;
+	elr_object_pool& operator=(const elr_object_pool&) = delete;
+
+	/*
+	** Ӷڴ鲢Ϲ
+	** ʧʱ׳std::bad_alloc캯׳쳣ԭ׳ڴ˻ضء
+	*/
+	/*! \brief construct an object in the pool.
+	 *  \param args arguments forwarded to the constructor of T.
+	 *  \retval handle that gives the object back to the pool.
+	 */
+	template <typename... Args>
+	pointer make(Args&&... args)
+	{
+		void* mem = elr_mpl_alloc(&pool_);
+
+		if (mem == NULL)
+			throw std::bad_alloc();
+
+		try
+		{
+			return pointer(new (mem) T(std::forward<Args>(args)...));
+		}
+		catch (...)
+		{
+			discard(mem);
+			throw;
+		}
+	}
+
+	/*! \brief the underlying memory pool, for statistics and trimming.
+	 */
+	elr_mpl_ht handle() { return &pool_; }
+
+private:
+	static elr_mpl_callback on_free()
+	{
+		return std::is_trivially_destructible<T>::value ? NULL : &destruct;
+	}
+
+	/*ʧܵڴ˻ʱֲִ֪߳̾ͨص*/
+	static bool& discarding()
+	{
+		static thread_local bool flag = false;
+		return flag;
+	}
+
+	static void destruct(void* mem)
+	{
+		if (!discarding())
+			static_cast<T*>(mem)->~T();
+	}
+
+	static void discard(void* mem)
+	{
+		discarding() = true;
+		elr_mpl_free(mem);
+		discarding() = false;
+	}
+
+	elr_mpl_t pool_;
+};
+
+#endif // __ELR_OBJECT_POOL_HPP__
@@ -0,0 +1,407 @@
+/*
+** malloc interposition library over elr_mpl, linux with glibc only.
+**
+** Build from the root of the repository:
+**   gcc -O2 -fPIC -shared -DELR_USE_THREAD \
+**       -DELR_NODE_ALLOC=elr_preload_node_alloc \
+**       -DELR_NODE_FREE=elr_preload_node_free \
+**       -Iinc src/elr_mpl.c src/elr_mtx.c \
+**       preload/elr_preload.c preload/elr_preload_new.cpp \
+**       -o libelr_preload.so -pthread -latomic -ldl -lstdc++
+** Run:
+**   LD_PRELOAD=./libelr_preload.so program
+** or link libelr_preload.so into the program.
+**
+** malloc, calloc, realloc, reallocarray, free, memalign, posix_memalign,
+** aligned_alloc, valloc, pvalloc and malloc_usable_size are replaced,
+** elr_preload_new.cpp replaces the global operator new and delete.
+** Requests up to the largest size class with an alignment of at most
+** ELR_PRELOAD_ALIGN bytes are served from a multi size memory pool, all
+** others are forwarded to the glibc allocator.
+**
+** Memory nodes of the memory pools are carved from one reserved address
+** range, so free tells pool memory from foreign memory by its address
+** alone, whatever allocated the foreign memory. Allocations made by the
+** memory pool module itself, such as thread caches, go to glibc.
+**
+** Environment:
+**   ELR_PRELOAD_CLASSES  file of size classes, see elr_mpl_save_classes.
+**                        the default is geometric from 16 bytes to
+**                        ELR_PRELOAD_MAX_SIZE with 12.5% waste at most.
+**
+** The memory pool module is never finalized, memory may be freed until
+** the very end of the process. Locks of the memory pools are not taken
+** around fork, a child of a multi-threaded process must not allocate
+** before exec.
+*/
+#define _GNU_SOURCE
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <malloc.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "elr_mpl.h"
+
+#if !defined(ELR_USE_THREAD) || !defined(ELR_NODE_ALLOC)
+#error "build with -DELR_USE_THREAD -DELR_NODE_ALLOC=elr_preload_node_alloc -DELR_NODE_FREE=elr_preload_node_free"
+#endif
+
+/*alignment of memory blocks from the memory pool, the one glibc malloc guarantees*/
+#define ELR_PRELOAD_ALIGN          (2 * sizeof(void*))
+
+/*largest size class of the default table*/
+#define ELR_PRELOAD_MAX_SIZE       8192
+#define ELR_PRELOAD_MAX_WASTE      0.125
+#define ELR_PRELOAD_MAX_CLASSES    64
+
+/*address range reserved for memory nodes, committed in steps of ELR_PRELOAD_COMMIT_SIZE*/
+#define ELR_PRELOAD_REGION_SIZE    ((size_t)1 << (sizeof(void*) == 8 ? 36 : 28))
+#define ELR_PRELOAD_COMMIT_SIZE    ((size_t)1 << 20)
+
+/*memory nodes are carved on this boundary*/
+#define ELR_PRELOAD_NODE_ALIGN     64
+
+/*distinct memory node sizes whose freed nodes are kept for reuse*/
+#define ELR_PRELOAD_NODE_SIZES     64
+
+#define ELR_PRELOAD_UNINIT         0
+#define ELR_PRELOAD_INITIALIZING   1
+#define ELR_PRELOAD_READY          2
+#define ELR_PRELOAD_FAILED         3
+
+#define ELR_ALIGN(size, boundary)  (((size) + ((boundary) - 1)) & ~((boundary) - 1))
+
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t n, size_t size);
+extern void* __libc_realloc(void* mem, size_t size);
+extern void* __libc_memalign(size_t align, size_t size);
+extern void  __libc_free(void* mem);
+
+typedef struct __elr_preload_free_nodes
+{
+	size_t  size;
+	void   *first;
+}
+elr_preload_free_nodes;
+
+void* elr_preload_node_alloc(size_t size);
+void  elr_preload_node_free(void* mem, size_t size);
+
+static int                    g_state = ELR_PRELOAD_UNINIT;
+static elr_mpl_t              g_pool;
+static size_t                 g_max_size = 0;
+
+static char                  *g_region = NULL;
+static size_t                 g_region_used = 0;
+static size_t                 g_region_committed = 0;
+static elr_preload_free_nodes g_free_nodes[ELR_PRELOAD_NODE_SIZES];
+static pthread_mutex_t        g_region_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static size_t              (*g_usable_size)(void*) = NULL;
+
+/*
+** nonzero while the thread is inside the memory pool module,
+** allocations made there go to glibc.
+*/
+static __thread int g_depth __attribute__((tls_model("initial-exec"))) = 0;
+
+/*
+** memory pool module and the reserved address range are set up by the
+** first thread to get here, other threads use glibc meanwhile.
+*/
+static int _elr_preload_init()
+{
+	size_t  classes[ELR_PRELOAD_MAX_CLASSES];
+	int     count = 0;
+	char   *path = NULL;
+	int     expected = ELR_PRELOAD_UNINIT;
+
+	if (__atomic_load_n(&g_state, __ATOMIC_ACQUIRE) == ELR_PRELOAD_READY)
+		return 1;
+	if (!__atomic_compare_exchange_n(&g_state, &expected, ELR_PRELOAD_INITIALIZING,
+		0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+		return 0;
+
+	g_depth++;
+	g_region = (char*)mmap(NULL, ELR_PRELOAD_REGION_SIZE, PROT_NONE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (g_region == MAP_FAILED)
+		g_region = NULL;
+
+	if ((path = getenv("ELR_PRELOAD_CLASSES")) != NULL)
+		count = elr_mpl_load_classes(path, classes, ELR_PRELOAD_MAX_CLASSES);
+	if (count <= 0 || count > ELR_PRELOAD_MAX_CLASSES)
+		count = elr_mpl_geometric_classes(ELR_PRELOAD_ALIGN, ELR_PRELOAD_MAX_SIZE,
+			ELR_PRELOAD_MAX_WASTE, classes, ELR_PRELOAD_MAX_CLASSES);
+	if (count > ELR_PRELOAD_MAX_CLASSES)
+		count = ELR_PRELOAD_MAX_CLASSES;
+
+	if (g_region != NULL && count > 0 && elr_mpl_init() != 0)
+	{
+		g_pool = elr_mpl_create_multi_aligned_sync(NULL, count, classes,
+			ELR_PRELOAD_ALIGN, NULL, NULL);
+		if (g_pool.pool != NULL)
+		{
+			/*every request reaching the pool fits a class, large mappings are never made*/
+			elr_mpl_set_large_size(&g_pool, 0);
+			g_max_size = classes[count - 1];
+		}
+	}
+	g_depth--;
+
+	__atomic_store_n(&g_state, g_max_size > 0 ? ELR_PRELOAD_READY : ELR_PRELOAD_FAILED,
+		__ATOMIC_RELEASE);
+	return g_max_size > 0;
+}
+
+__attribute__((constructor)) static void _elr_preload_ctor()
+{
+	_elr_preload_init();
+}
+
+/*whether mem lies in the reserved address range, that is whether it came from the memory pool*/
+static inline int _elr_preload_owns(const void* mem)
+{
+	return g_region != NULL && (size_t)((const char*)mem - g_region) < ELR_PRELOAD_REGION_SIZE;
+}
+
+/*
+** nodes freed before are reused by exact size, others are carved from the
+** reserved address range, which is committed as it is used up.
+*/
+void* elr_preload_node_alloc(size_t size)
+{
+	void   *node = NULL;
+	size_t  commit = 0;
+	int     i = 0;
+
+	size = ELR_ALIGN(size, ELR_PRELOAD_NODE_ALIGN);
+	pthread_mutex_lock(&g_region_mutex);
+	for (i = 0; i < ELR_PRELOAD_NODE_SIZES && g_free_nodes[i].size != 0; i++)
+	{
+		if (g_free_nodes[i].size == size && g_free_nodes[i].first != NULL)
+		{
+			node = g_free_nodes[i].first;
+			g_free_nodes[i].first = *(void**)node;
+			break;
+		}
+	}
+
+	if (node == NULL && g_region != NULL && size <= ELR_PRELOAD_REGION_SIZE - g_region_used)
+	{
+		if (g_region_used + size > g_region_committed)
+		{
+			commit = ELR_ALIGN(g_region_used + size - g_region_committed, ELR_PRELOAD_COMMIT_SIZE);
+			if (commit > ELR_PRELOAD_REGION_SIZE - g_region_committed)
+				commit = ELR_PRELOAD_REGION_SIZE - g_region_committed;
+			if (mprotect(g_region + g_region_committed, commit, PROT_READ | PROT_WRITE) == 0)
+				g_region_committed += commit;
+		}
+		if (g_region_used + size <= g_region_committed)
+		{
+			node = g_region + g_region_used;
+			g_region_used += size;
+		}
+	}
+	pthread_mutex_unlock(&g_region_mutex);
+
+	return node;
+}
+
+/*
+** pages entirely inside the node are given back to the system,
+** the node itself is kept for reuse by size.
+*/
+void elr_preload_node_free(void* mem, size_t size)
+{
+	size_t  page = (size_t)sysconf(_SC_PAGESIZE);
+	char   *first = (char*)ELR_ALIGN((size_t)mem + sizeof(void*), page);
+	char   *last = (char*)(((size_t)mem + size) & ~(page - 1));
+	int     i = 0;
+
+	size = ELR_ALIGN(size, ELR_PRELOAD_NODE_ALIGN);
+	if (first < last)
+		madvise(first, last - first, MADV_DONTNEED);
+
+	pthread_mutex_lock(&g_region_mutex);
+	for (i = 0; i < ELR_PRELOAD_NODE_SIZES; i++)
+	{
+		if (g_free_nodes[i].size == 0)
+			g_free_nodes[i].size = size;
+		if (g_free_nodes[i].size == size)
+		{
+			*(void**)mem = g_free_nodes[i].first;
+			g_free_nodes[i].first = mem;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&g_region_mutex);
+}
+
+void* malloc(size_t size)
+{
+	void *mem = NULL;
+
+	if (g_depth == 0 && size <= g_max_size && _elr_preload_init())
+	{
+		g_depth++;
+		mem = elr_mpl_alloc_multi(&g_pool, size);
+		g_depth--;
+		if (mem != NULL)
+			return mem;
+	}
+
+	return __libc_malloc(size);
+}
+
+void free(void* mem)
+{
+	if (mem == NULL)
+		return;
+
+	if (_elr_preload_owns(mem))
+	{
+		g_depth++;
+		elr_mpl_free(mem);
+		g_depth--;
+		return;
+	}
+
+	__libc_free(mem);
+}
+
+void* calloc(size_t n, size_t size)
+{
+	void *mem = NULL;
+
+	if (size != 0 && n > (size_t)-1 / size)
+	{
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	if (g_depth == 0 && n * size <= g_max_size && _elr_preload_init())
+	{
+		g_depth++;
+		mem = elr_mpl_calloc_multi(&g_pool, n * size);
+		g_depth--;
+		if (mem != NULL)
+			return mem;
+	}
+
+	return __libc_calloc(n, size);
+}
+
+/*
+** pool memory stays in the pool while it fits a class and moves to glibc
+** when it outgrows them, foreign memory stays with glibc.
+*/
+void* realloc(void* mem, size_t size)
+{
+	void   *new_mem = NULL;
+	size_t  old_size = 0;
+
+	if (mem == NULL)
+		return malloc(size);
+
+	if (!_elr_preload_owns(mem))
+		return __libc_realloc(mem, size);
+
+	if (size == 0)
+	{
+		free(mem);
+		return NULL;
+	}
+
+	g_depth++;
+	if (size <= g_max_size)
+		new_mem = elr_mpl_realloc_multi(&g_pool, mem, size);
+	if (new_mem == NULL)
+	{
+		old_size = elr_mpl_size(mem);
+		if ((new_mem = __libc_malloc(size)) != NULL)
+		{
+			memcpy(new_mem, mem, old_size < size ? old_size : size);
+			elr_mpl_free(mem);
+		}
+	}
+	g_depth--;
+
+	return new_mem;
+}
+
+void* reallocarray(void* mem, size_t n, size_t size)
+{
+	if (size != 0 && n > (size_t)-1 / size)
+	{
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	return realloc(mem, n * size);
+}
+
+void* memalign(size_t align, size_t size)
+{
+	if (align <= ELR_PRELOAD_ALIGN)
+		return malloc(size);
+
+	return __libc_memalign(align, size);
+}
+
+int posix_memalign(void** mem, size_t align, size_t size)
+{
+	void *new_mem = NULL;
+
+	if (align % sizeof(void*) != 0 || (align & (align - 1)) != 0 || align == 0)
+		return EINVAL;
+
+	if ((new_mem = memalign(align, size)) == NULL)
+		return ENOMEM;
+
+	*mem = new_mem;
+	return 0;
+}
+
+void* aligned_alloc(size_t align, size_t size)
+{
+	return memalign(align, size);
+}
+
+void* valloc(size_t size)
+{
+	return __libc_memalign((size_t)sysconf(_SC_PAGESIZE), size);
+}
+
+void* pvalloc(size_t size)
+{
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+	return __libc_memalign(page, ELR_ALIGN(size, page));
+}
+
+size_t malloc_usable_size(void* mem)
+{
+	size_t size = 0;
+
+	if (mem == NULL)
+		return 0;
+
+	if (_elr_preload_owns(mem))
+		return elr_mpl_size(mem);
+
+	if (g_usable_size == NULL)
+	{
+		g_depth++;
+		g_usable_size = (size_t(*)(void*))dlsym(RTLD_NEXT, "malloc_usable_size");
+		g_depth--;
+	}
+	if (g_usable_size != NULL)
+		size = g_usable_size(mem);
+
+	return size;
+}
@@ -0,0 +1,177 @@
+/*
+** global operator new and delete of the malloc interposition library,
+** see elr_preload.c for the build command.
+**
+** operator new goes to the interposed malloc, so node sized objects come
+** from the memory pool. over-aligned new goes to aligned_alloc.
+*/
+#include <cstdlib>
+#include <new>
+
+static void* _elr_preload_new(std::size_t size)
+{
+	void *mem = NULL;
+
+	if (size == 0)
+		size = 1;
+
+	while ((mem = std::malloc(size)) == NULL)
+	{
+		std::new_handler handler = std::get_new_handler();
+		if (handler == NULL)
+			throw std::bad_alloc();
+		handler();
+	}
+
+	return mem;
+}
+
+void* operator new(std::size_t size)
+{
+	return _elr_preload_new(size);
+}
+
+void* operator new[](std::size_t size)
+{
+	return _elr_preload_new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	try
+	{
+		return _elr_preload_new(size);
+	}
+	catch (...)
+	{
+		return NULL;
+	}
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	try
+	{
+		return _elr_preload_new(size);
+	}
+	catch (...)
+	{
+		return NULL;
+	}
+}
+
+void operator delete(void* mem) noexcept
+{
+	std::free(mem);
+}
+
+void operator delete[](void* mem) noexcept
+{
+	std::free(mem);
+}
+
+void operator delete(void* mem, const std::nothrow_t&) noexcept
+{
+	std::free(mem);
+}
+
+void operator delete[](void* mem, const std::nothrow_t&) noexcept
+{
+	std::free(mem);
+}
+
+#if __cpp_sized_deallocation
+void operator delete(void* mem, std::size_t) noexcept
+{
+	std::free(mem);
+}
+
+void operator delete[](void* mem, std::size_t) noexcept
+{
+	std::free(mem);
+}
+#endif // __cpp_sized_deallocation
+
+#if __cpp_aligned_new
+static void* _elr_preload_new_aligned(std::size_t size, std::align_val_t align)
+{
+	void *mem = NULL;
+
+	if (size == 0)
+		size = 1;
+
+	while (posix_memalign(&mem, static_cast<std::size_t>(align), size) != 0)
+	{
+		std::new_handler handler = std::get_new_handler();
+		if (handler == NULL)
+			throw std::bad_alloc();
+		handler();
+	}
+
+	return mem;
+}
+
+void* operator new(std::size_t size, std::align_val_t align)
+{
+	return _elr_preload_new_aligned(size, align);
+}
+
+void* operator new[](std::size_t size, std::align_val_t align)
+{
+	return _elr_preload_new_aligned(size, align);
+}
+
+void* operator new(std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept
+{
+	try
+	{
+		return _elr_preload_new_aligned(size, align);
+	}
+	catch (...)
+	{
+		return NULL;
+	}
+}
+
+void* operator new[](std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept
+{
+	try
+	{
+		return _elr_preload_new_aligned(size, align);
+	}
+	catch (...)
+	{
+		return NULL;
+	}
+}
+
+void operator delete(void* mem, std::align_val_t) noexcept
+{
+	std::free(mem);
+}
+
+void operator delete[](void* mem, std::align_val_t) noexcept
+{
+	std::free(mem);
+}
+
+void operator delete(void* mem, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	std::free(mem);
+}
+
+void operator delete[](void* mem, std::align_val_t, const std::nothrow_t&) noexcept
+{
+	std::free(mem);
+}
+
+void operator delete(void* mem, std::size_t, std::align_val_t) noexcept
+{
+	std::free(mem);
+}
+
+void operator delete[](void* mem, std::size_t, std::align_val_t) noexcept
+{
+	std::free(mem);
+}
+#endif // __cpp_aligned_new
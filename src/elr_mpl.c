@@ -1,8 +1,31 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
 #include <stdarg.h>
+#if defined(_MSC_VER) || defined(__MINGW32__)
+#include <malloc.h>
+#endif
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#include <sched.h>
+#endif
+#if defined(ELR_USE_HISTOGRAM) && !defined(_WIN32)
+#include <time.h>
+#endif // ELR_USE_HISTOGRAM
+#if defined(ELR_USE_SAMPLING) && defined(__GLIBC__)
+#include <execinfo.h>
+#endif // ELR_USE_SAMPLING
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ELR_HAS_SSE2
+#endif
 
 #include "elr_mpl.h"
 
@@ -24,12 +47,100 @@
 /*´ڴصڴСӦǴСELR_OVERRANGE_UNIT_SIZEС*/
 #define ELR_OVERRANGE_UNIT_SIZE            1024  /*1KB*/
 
+/*ߴڴسߴ*/
+#define ELR_CLASS_INDEX_SIZE               256
+
+/*ߴڴسߴСΪ2ELR_CLASS_MIN_SHIFTֽ*/
+#define ELR_CLASS_MIN_SHIFT                3
+
+/*ߴڴĬϵĴڴֵobj_sizeҲСڴֱֵӳڴҳ*/
+#define ELR_LARGE_OBJECT_SIZE              ELR_MAX_SLICE_SIZE  /*32KB*/
+
+/*ÿڴڴ໺ͷڴӳ*/
+#define ELR_LARGE_CACHE_COUNT              8
+
+/*ҳĴСʹôҳڴصڴڵС*/
+#define ELR_HUGE_PAGE_SIZE                 2097152  /*2MB*/
+
 /*Զ黹ڵռڴϵͳڴռֵ*/
 /*ͨڴڴ512MBʱͷڴ治ͷ*/
 #define ELR_AUTO_FREE_NODE_THRESHOLD       536870912 /*512MB*/
 
+/*ڴصĿƬջΪʱڴڵһλֳƬ*/
+#define ELR_LOCKFREE_REFILL_COUNT          16
+
+/*ڴصڴڵСڴڵ㰴˴С룬2*/
+/*ڴַελõڴڵ㣬ڴ鲻ҪƬͷ*/
+#define ELR_COMPACT_NODE_SHIFT             16
+#define ELR_COMPACT_NODE_SIZE              (1 << ELR_COMPACT_NODE_SHIFT)  /*64KB*/
+
+/*ڴڵнڵͷռݵֽ֮ڴ*/
+#define ELR_COMPACT_NODE_HEAD              ELR_ALIGN(sizeof(elr_mem_node), 2 * sizeof(void*))
+
+/*ڴһڴڵٰڴﲻʱ˻Ϊͨڴ*/
+#define ELR_COMPACT_MIN_SLICE_COUNT        8
+
+/*ڴڵַһλΪλͼÿһλӦһڴڵСĵַ*/
+#define ELR_CHUNK_MAP_BITS                 16
+#define ELR_CHUNK_LEAF_WORDS               ((1 << ELR_CHUNK_MAP_BITS) / (8 * sizeof(unsigned int)))
+
+/*mallocصڴĶ룬ҪĶʱڴڵ㰴*/
+#define ELR_MALLOC_ALIGN                   (2 * sizeof(void*))
+
+/*㳬ֽڴʱʹ÷ʱ洢ڴ뻺*/
+#define ELR_ZERO_STREAM_SIZE               65536  /*64KB*/
+
+/*ڴصڴڵСȣĬϵڴڵELR_COMPACT_MIN_SLICE_COUNTڴ*/
+#define ELR_ARENA_NODE_SIZE                65536
+
+/*ڴڵнڵͷռݵֽڴ鰴ELR_MALLOC_ALIGN*/
+#define ELR_ARENA_NODE_HEAD                ELR_ALIGN(sizeof(elr_mem_node), ELR_MALLOC_ALIGN)
+
+/*ͳƼ߳ģʽԭӼҪ*/
+#ifdef ELR_USE_THREAD
+typedef elr_atomic_t                       elr_stat_counter;
+#else
+typedef size_t                             elr_stat_counter;
+#endif // ELR_USE_THREAD
+
+/*64λͳƼڳʱᳬ2^31ֽʹwindowsLONGֻ32λ*/
+#ifdef ELR_USE_THREAD
+typedef elr_atomic64_t                     elr_stat_counter64;
+#else
+typedef unsigned long long                 elr_stat_counter64;
+#endif // ELR_USE_THREAD
+
+#ifdef ELR_USE_HISTOGRAM
+/*ӳֱͼͰkͰ¼[2^k,2^(k+1))ӳ٣0ͰҲ¼0*/
+#define ELR_LATENCY_BUCKETS                40
+#endif // ELR_USE_HISTOGRAM
+
+/*ߴֱͼȺͷΧkͰ¼(k*unit,(k+1)*unit]ֽڵ룬0ֽҲڵ0Ͱ*/
+/*ΧһͰУߴļ*/
+#define ELR_PROFILE_UNIT                   8
+#define ELR_PROFILE_MAX_SIZE               65536
+#define ELR_PROFILE_BUCKETS                (ELR_PROFILE_MAX_SIZE / ELR_PROFILE_UNIT)
+
+#ifdef ELR_USE_SAMPLING
+/*Ѳ¼ĵջȣԼڴģջ֡*/
+#define ELR_SAMPLE_MAX_DEPTH               32
+#define ELR_SAMPLE_SKIP_FRAMES             2
+/*Ѳ¼ɢбͰ2*/
+#define ELR_SAMPLE_BUCKETS                 4096
+#define ELR_SAMPLE_BUCKET(mem)             ((((size_t)(mem) >> 4) ^ ((size_t)(mem) >> 16)) & (ELR_SAMPLE_BUCKETS - 1))
+#endif // ELR_USE_SAMPLING
+
 #define ELR_ALIGN(size, boundary)     (((size) + ((boundary) - 1)) & ~((boundary) - 1)) 
 
+/*
+** ʱELR_NODE_ALLOCELR_NODE_FREEָ͹黹ڴڵĺ
+** 滻Ҫڴڵmallocfreemallocؿ˵ǼڴڵĵַΧ
+*/
+#ifdef ELR_NODE_ALLOC
+void* ELR_NODE_ALLOC(size_t size);
+void  ELR_NODE_FREE(void* mem, size_t size);
+#endif // ELR_NODE_ALLOC
+
 /*! \brief memory node type.
  *
  */
@@ -58,6 +169,10 @@ typedef struct __elr_mem_slice
     elr_mem_node                *node;
 	/*ƬıǩʼֵΪ0ÿһδڴȡ͹黹1*/
 	int                          tag;
+#ifdef ELR_USE_SAMPLING
+	/*õڴǷ񱻲ͷʱݴɾ¼*/
+	int                          sampled;
+#endif // ELR_USE_SAMPLING
 }
 elr_mem_slice;
 
@@ -71,6 +186,47 @@ typedef struct __elr_mem_pool
 	struct __elr_mem_pool      **multi;
 	/*multiаڴص*/
 	int                          multi_count;
+	/*CPUƬڴصĸƬǱڴصڴ*/
+	struct __elr_mem_pool      **shards;
+	int                          shard_count;
+	/*ߴkǵһС(k<<class_shift)+1ֽڵڴmultiе±*/
+	int                         *class_index;
+	size_t                       class_index_count;
+	int                          class_shift;
+	/*ΧڴɵĹϣELR_OVERRANGE_UNIT_SIZEı*/
+	struct __elr_mem_pool      **overrange;
+	size_t                       overrange_capacity;
+	size_t                       overrange_count;
+	/*ڴֵ0ʾʹôڴڴ*/
+	size_t                       large_size;
+	/*ߴڴǷ¼ߴֱͼ*/
+	int                          profiling;
+	/*ߴֱͼELR_PROFILE_BUCKETS+1Ͱһοʼ¼ʱ룬ֱڴٲͷ*/
+	elr_stat_counter64          *size_profile;
+	/*ߴڴصĴڴڴأһõʱ*/
+	struct __elr_mem_pool       *large_pool;
+	/*ǷǴڴڴأÿڴڵһڴӳ䣬ֻһڴ*/
+	int                          large;
+	/*ͷŵڴӳɵͨڵnext*/
+	elr_mem_node                *large_cache;
+	size_t                       large_cache_count;
+	/*ڴڵǷʹôҳ*/
+	int                          huge;
+	/*ڴڵֹƬǰûƬڴڵ*/
+	size_t                       empty_node_count;
+	/*Ƿ˱ԣûʱELR_AUTO_FREE_NODE_THRESHOLDͷſڴڵ*/
+	int                          retain;
+	/*ڴڵ㳬retain_highʱͷŵֻʣretain_low*/
+	size_t                       retain_low;
+	size_t                       retain_high;
+	/*ڴӽǵƬֵ̻߳еƬҲ*/
+	size_t                       live_slice_count;
+	size_t                       peak_slice_count;
+	/*ͷڴĴ̻߳Ĵ䲹͹黹ʱϲ*/
+	size_t                       alloc_count;
+	size_t                       free_count;
+	/*ڴڵĴ*/
+	size_t                       node_alloc_count;
 	/*ÿelr_mem_nodeslice*/
     size_t                       slice_count;
     size_t                       slice_size;
@@ -89,17 +245,109 @@ typedef struct __elr_mem_pool
 	elr_mpl_callback             on_slice_free;
 	/*õڴƬ*/
 	elr_mem_slice               *first_occupied_slice;
+	/*ǷάõڴƬֻʱڴִon_slice_free*/
+	/*Ĭָֻon_slice_freeʱά*/
+	int                          track;
 	/*ɱڴضڴƬıǩ*/
 	int                          slice_tag;
+	/*ǷǽڴأڴصڴûƬͷ*/
+	int                          compact;
+	/*ڴصĿڴͨڴǰֽ*/
+	void                        *first_free_object;
+	/*ǷǾڴأڴڴڵ˳򻮷֣ͷ*/
+	/*ڴڵ㰴˳ӣnewly_alloc_nodeڻֵĽڵ㣬Ľڵ㶼ûʹ*/
+	/*ڴڵused_slice_count¼ڵֽ*/
+	int                          arena;
+	/*ڴĶֽ0ʾֻint*/
+	size_t                       align;
 #ifdef ELR_USE_THREAD
 	/*ͬǷ񴴽*/
 	int                          sync;
 	/*ͬ*/
     elr_mtx                      pool_mutex;
+	/*ÿ̻߳Ƭ0ʾʹ̻߳*/
+	size_t                       cache_size;
+	/*߳ڱڴϵĻɵ*/
+	struct __elr_thread_cache   *first_cache;
+	/*Ƿڴ*/
+	int                          lockfree;
+	/*ڴصĿƬջջǩȡջƬıǩ*/
+	volatile elr_tagged_ptr      free_stack;
+	/*ڴͷڴĴ64λв*/
+	elr_atomic64_t               lockfree_allocs;
+	elr_atomic64_t               lockfree_frees;
+	/*ӵڴص̣߳0ʾڴزĳ߳*/
+	/*ֻӵߴ룬ӵ߲ͷ*/
+	unsigned long                owner_thread;
+	/*߳ͷŵƬɵջͨƬnextӣӵʱһȡ*/
+	elr_atomic_ptr               remote_free;
 #endif // ELR_USE_THREAD
+#ifdef ELR_USE_HISTOGRAM
+	/*롢ͷšڴڵ͵ȴӳֱͼ߳ģʽԭӼҪ*/
+	elr_stat_counter          latency[ELR_MPL_LATENCY_KINDS][ELR_LATENCY_BUCKETS];
+	/*ͨߴڴشӱڴĴֽͳڲƬ*/
+	elr_stat_counter64        request_count;
+	elr_stat_counter64        request_size;
+#endif // ELR_USE_HISTOGRAM
 }
 elr_mem_pool;
 
+#ifdef ELR_USE_THREAD
+/*̻߳棬ÿ߳ÿڴϸһ*/
+/*еƬڴضѷģǩΪżʾʹ߶ǿе*/
+typedef struct __elr_thread_cache
+{
+	/*ڴأڴٺΪNULL*/
+	elr_mem_pool                *pool;
+	/*ͬһ̵߳Ļ*/
+	struct __elr_thread_cache   *next;
+	/*ͬһڴصĻ*/
+	struct __elr_thread_cache   *pool_prev;
+	struct __elr_thread_cache   *pool_next;
+	/*ĿƬ*/
+	size_t                       count;
+	/*߳ͨͷڴĴδϲڴ*/
+	size_t                       alloc_count;
+	size_t                       free_count;
+	/*ƬջΪڴصcache_size*/
+	elr_mem_slice              **slices;
+}
+elr_thread_cache;
+
+/*߳ģֲ߳̾洢*/
+typedef struct __elr_thread_ctx
+{
+	/*߳ӵеĻɵ*/
+	elr_thread_cache            *first_cache;
+	struct __elr_thread_ctx     *prev;
+	struct __elr_thread_ctx     *next;
+#ifdef ELR_USE_SAMPLING
+	/*һβҪֽΪ0ʱ*/
+	size_t                       sample_left;
+	/*ɲ״̬*/
+	unsigned int                 sample_seed;
+#endif // ELR_USE_SAMPLING
+}
+elr_thread_ctx;
+#endif // ELR_USE_THREAD
+
+#ifdef ELR_USE_SAMPLING
+/*Ѳ¼ڴĵַɢ*/
+typedef struct __elr_heap_sample
+{
+	struct __elr_heap_sample    *next;
+	/*ڴ鼰ڴ*/
+	void                        *mem;
+	elr_mem_pool                *pool;
+	/*ڴֽ*/
+	size_t                       size;
+	/*ڴʱĵջӵ߿ʼ*/
+	int                          depth;
+	void                        *stack[ELR_SAMPLE_MAX_DEPTH];
+}
+elr_heap_sample;
+#endif // ELR_USE_SAMPLING
+
 
 /*ȫڴ*/
 static elr_mem_pool   g_mem_pool;
@@ -107,19 +355,67 @@ static elr_mem_pool   g_mem_pool;
 static elr_mpl_t      g_multi_mem_pool;
 /*ڴռݵڴ*/
 static size_t         g_occupation_size;
+/*ϵͳڴҳС*/
+static size_t         g_page_size;
+/*CPUƬڴصķƬ*/
+static int            g_cpu_count;
+/*ͨMAP_HUGETLBҳʧֱܹ֮ʹ͸ҳ*/
+static int            g_hugetlb_failed;
+/*ڴڵַһΪַĸλΪλͼ*/
+static unsigned int * volatile g_chunk_map[1 << ELR_CHUNK_MAP_BITS];
 
 elr_mpl_t ELR_MPL_INITIALIZER = { NULL,0 };
 
 /*ȫڴü*/
 #ifdef ELR_USE_THREAD
 static elr_atomic_t     g_mpl_refs = ELR_ATOMIC_ZERO;
+/*ģʼĴжϵһʹʱڴǷڱγʼ*/
+static elr_atomic_t     g_mpl_epoch = ELR_ATOMIC_ZERO;
+/*߳ĵֲ߳̾洢*/
+static elr_tls_t        g_cache_key;
+/*߳ĺ̻߳ͬ*/
+static elr_mtx          g_cache_mutex;
+/*߳ɵ*/
+static elr_thread_ctx  *g_first_thread_ctx = NULL;
+/*̻߳ģǷãģֹ߳˳صٴ*/
+static int              g_cache_alive = 0;
+/*ڴڵַͬ*/
+static elr_mtx          g_chunk_mutex;
+/*ڴڴʱУκڴصȡ*/
+static elr_mtx          g_tree_mutex;
+/*ڴڵΪ0ʱͷڴ治زѯַ*/
+static elr_atomic_t     g_compact_node_count = ELR_ATOMIC_ZERO;
 #else
 static long           g_mpl_refs = 0;
+static int            g_mpl_epoch = 0;
+static long           g_compact_node_count = 0;
 #endif // ELR_USE_THREAD
+#if defined(ELR_USE_HISTOGRAM) && defined(_WIN32)
+/*߾ȼƵʣÿļ*/
+static LARGE_INTEGER  g_perf_freq;
+#endif // ELR_USE_HISTOGRAM
+#ifdef ELR_USE_SAMPLING
+/*ƽÿֽڲһΣΪ0ʱ*/
+static volatile size_t  g_sample_rate = 0;
+/*һõķ0ʣдļpprofԭʵʵֽ*/
+static size_t           g_sample_period = 0;
+/*ڴַɢеĲ¼*/
+static elr_heap_sample *g_samples[ELR_SAMPLE_BUCKETS];
+/*¼Ϊ0ʱڴززҲ¼*/
+static size_t           g_sample_count = 0;
+#ifdef ELR_USE_THREAD
+/*¼ͬ*/
+static elr_mtx          g_sample_mutex;
+#else
+static size_t           g_sample_left = 0;
+static unsigned int     g_sample_seed = 1;
+#endif // ELR_USE_THREAD
+#endif // ELR_USE_SAMPLING
 
 /*һڴأָ䵥ԪСsyncִǷ֧ͬ֡*/
 elr_mem_pool*       _elr_mpl_create(elr_mem_pool* pool, 
 	                                size_t obj_size, 
+	                                size_t align, 
 	                                elr_mpl_callback on_alloc, 
 	                                elr_mpl_callback on_free, 
 	                                int sync);
@@ -127,21 +423,165 @@ elr_mem_pool*       _elr_mpl_create(elr_mem_pool* pool,
 elr_mem_pool*       _elr_mpl_create_multi(elr_mem_pool* pool,
 	                                      int obj_size_count,
 	                                      size_t* obj_size,
+	                                      size_t align,
 	                                      elr_mpl_callback on_alloc, 
 	                                      elr_mpl_callback on_free, 
 	                                      int sync);
 /*жڴǷЧ*/
 int                 _elr_mpl_avail(elr_mem_pool* pool);
+/*Ϊߴڴؽߴʧܷ0*/
+int                 _elr_class_index_build(elr_mem_pool* pool);
+/*ڶߴڴвҵһsizeֽڵڴص±꣬ʱmulti_count*/
+int                 _elr_class_of(elr_mem_pool* pool, size_t size);
+/*һ򴴽sizeֽڵĳΧڴأ߸*/
+elr_mem_pool*       _elr_overrange_pool(elr_mem_pool* pool, size_t size);
+/*Ӵڴڴsizeֽڵڴ*/
+void*               _elr_large_alloc(elr_mem_pool* pool, size_t size, int zero);
+/*ڴ黹ڴڴ*/
+void                _elr_large_free(elr_mem_pool* pool, elr_mem_slice* slice);
+#if defined(__linux__)
+/*ڴڴӳ䣬*/
+void*               _elr_large_remap(elr_mem_pool* pool, elr_mem_slice* slice, size_t size);
+#endif
+/*ͷlengthֽڵڴӳ*/
+void*               _elr_map(size_t length);
+void                _elr_unmap(void* addr, size_t length);
+/*lengthֽڰҳڴӳ䣬ʹôҳ*/
+void*               _elr_map_huge(size_t length);
+/*ڴǷʹôҳڴڴڵʱ0*/
+int                 _elr_mpl_set_huge(elr_mem_pool* pool, int enable);
+/*ڴǷάõڴƬ*/
+int                 _elr_mpl_set_tracking(elr_mem_pool* pool, int enable);
+/*ͷڴصĿڴڵֱֻʣkeepͷŵֽ߸*/
+size_t              _elr_mpl_release_empty(elr_mem_pool* pool, size_t keep);
+/*ͷڴؼڴصĿڴڵ㣬ͷŵֽ*/
+size_t              _elr_mpl_trim(elr_mem_pool* pool, int recursive);
+/*Ƭn·ֵ߸*/
+void                _elr_live_add(elr_mem_pool* pool, size_t n);
+/*ڴؼڴصͳۼӵstats*/
+void                _elr_mpl_stats(elr_mem_pool* pool, elr_mpl_stats_t* stats, int recursive);
+/*ȡڴصĵһڴأ߸g_tree_mutex*/
+elr_mem_pool*       _elr_first_child(elr_mem_pool* pool);
+/*ȡһڴصڲƬͳ*/
+void                _elr_class_stats(elr_mem_pool* pool, elr_mpl_class_stats_t* stats);
+#ifdef ELR_USE_HISTOGRAM
+/*ʱӵĵǰʱ䣬λ*/
+unsigned long long  _elr_now();
+/*ڴصkindӳֱͼм¼һnsӳ*/
+void                _elr_latency_add(elr_mem_pool* pool, int kind, unsigned long long ns);
+/*ڴصӳֱͼrecursiveΪ0ʱҲڴص*/
+void                _elr_latency_reset(elr_mem_pool* pool, int recursive);
+/*ڴؼڴصkindӳֱͼۼӵcounts*/
+void                _elr_latency_sum(elr_mem_pool* pool, int kind, size_t* counts, int recursive);
+/*¼һͨߴڴص*/
+void                _elr_request_add(elr_mem_pool* pool, size_t size);
+#endif // ELR_USE_HISTOGRAM
+/*ڶߴڴصߴֱͼм¼һ*/
+void                _elr_profile_add(elr_mem_pool* pool, size_t size);
+#ifdef ELR_USE_SAMPLING
+/*ɾֵΪrateֽڵֲָĲ*/
+size_t              _elr_sample_interval(unsigned int *seed, size_t rate);
+/*ֽǷڴ飬ʱ¼ջ*/
+void                _elr_sample_alloc(elr_mem_pool *pool, void *mem, size_t size);
+/*ɾڴĲ¼*/
+void                _elr_sample_remove(void *mem);
+/*Ѳ¼Ƶڴµַ*/
+void                _elr_sample_move(void *mem, void *new_mem, size_t size);
+/*ɾڴڴв¼poolΪNULLʱɾȫ*/
+void                _elr_sample_drop(elr_mem_pool *pool);
+/*ջȽ¼*/
+int                 _elr_sample_compare(const void *a, const void *b);
+#endif // ELR_USE_SAMPLING
+#if defined(ELR_USE_THREAD) && defined(ELR_USE_HISTOGRAM)
+/*ڴز¼ȴʱ*/
+void                _elr_mpl_lock(elr_mem_pool* pool);
+#elif defined(ELR_USE_THREAD)
+#define             _elr_mpl_lock(pool)  elr_mtx_lock(&(pool)->pool_mutex)
+#endif
+/*ڴһڴ*/
+void*               _elr_mpl_alloc(elr_mem_pool* pool);
+/*ڴȡһڴ飬ִлص*/
+void*               _elr_mpl_take(elr_mem_pool* pool);
+/*ڶߴڴвһ򴴽sizeֽڵڴ*/
+elr_mem_pool*       _elr_multi_pool_of(elr_mem_pool* pool, size_t size);
+/*ڴ㣬ڴʹ÷ʱ洢*/
+void                _elr_zero(void* mem, size_t size);
+/*ڴ黹ڴأظڴ*/
+elr_mem_pool*       _elr_mpl_free(void* mem);
+/*մڴΪڴأڴʱΪͨڴ*/
+void                _elr_mpl_set_compact(elr_mem_pool* pool);
+/*մڴΪڴ*/
+void                _elr_mpl_set_arena(elr_mem_pool* pool);
+/*Ӿڴ˳򻮷ڴ*/
+void*               _elr_arena_alloc(elr_mem_pool *pool, size_t size);
+/*ڴػ˵ǵλ*/
+void                _elr_arena_rewind(elr_mem_pool *pool, const elr_mpl_mark_t *mark);
+/*ڴڵнڵͷռݵֽ֮ǵһڴƬ*/
+size_t              _elr_node_head(elr_mem_pool *pool);
 /*Ϊڴһڴڵ*/
 void                _elr_alloc_mem_node(elr_mem_pool *pool);
 /*ͷڴڵ*/
 void                _elr_free_mem_node(elr_mem_node* node);
+/*ϵͳڴڵڴ棬ڴصڴڵ㰴С*/
+elr_mem_node*       _elr_node_alloc(elr_mem_pool *pool);
+/*ڴڵڴ黹ϵͳ*/
+void                _elr_node_free(elr_mem_pool *pool, elr_mem_node *node);
+/*ڽڴڵַеǼǻעһڴڵ㣬Ǽʧܷ0*/
+int                 _elr_chunk_map_set(elr_mem_node *node, int on);
+/*ͷŽڴڵַжλͼ*/
+void                _elr_chunk_map_free();
+/*ȡڴĽڴڵ㣬ڴ鲻ڽڴʱNULL*/
+elr_mem_node*       _elr_compact_node_of(const void *mem);
+/*ӽڴȡһڴ飬߸*/
+void*               _elr_compact_take(elr_mem_pool *pool);
+/*ڴ黹ڴأ߸*/
+void                _elr_compact_release(elr_mem_pool *pool, elr_mem_node *node, void *mem);
 /*ڴصĸոմڴڵзһڴƬ*/
 elr_mem_slice*      _elr_slice_from_node(elr_mem_pool *pool);
 /*ڴзһڴƬ÷*/
 elr_mem_slice*      _elr_slice_from_pool(elr_mem_pool *pool);
-/*ڴأinnerʾǷǵݹڲãlock_thisǷҪǰͷŵڴ*/
+/*ڴأinnerʾǷǵݹڲãlock_thisǷҪǰͷŵڴأ
+innerΪ0ʱlock_thisΪ1ʾѾǰ*/
 void                _elr_mpl_destory(elr_mem_pool *pool, int inner, int lock_this);
+/*ڴȡһڴƬ߸*/
+elr_mem_slice*      _elr_slice_take(elr_mem_pool *pool);
+/*ѷڴƬ黹ڴأ߸޸ıǩִлص*/
+void                _elr_slice_release(elr_mem_pool *pool, elr_mem_slice *slice);
+/*ƬƬƳ*/
+void                _elr_slice_unlink(elr_mem_pool *pool, elr_mem_slice *slice);
+/*ͬһڴڵcountƬɵƬ*/
+void                _elr_chain_release(elr_mem_pool *pool, elr_mem_node *node,
+	                                   elr_mem_slice *first, elr_mem_slice *last, size_t count);
+/*ڴڵcountƬػֵ*/
+size_t              _elr_slices_from_node(elr_mem_pool *pool, size_t count, void** mem);
+#ifdef ELR_USE_THREAD
+/*߳˳ʱ߳леƬ黹ڴ*/
+void ELR_TLS_CALLBACK _elr_thread_exit(void* ctx);
+/*ȡǰ̵߳߳ģʱ*/
+elr_thread_ctx*     _elr_thread_ctx();
+/*ȡǰ߳ڴϵĻ棬ʱ*/
+elr_thread_cache*   _elr_cache_of(elr_mem_pool *pool);
+/*ӵǰ̵߳ĻзһڴƬ*/
+elr_mem_slice*      _elr_slice_from_cache(elr_mem_pool *pool);
+/*ջ׵countƬ黹ڴ*/
+void                _elr_cache_flush(elr_thread_cache *cache, size_t count);
+/*ʹڴؼڴϵ̻߳ʧЧ*/
+void                _elr_mpl_drop_caches(elr_mem_pool *pool);
+/*ڴصĿƬջеһƬջΪʱڴڵл*/
+elr_mem_slice*      _elr_slice_pop(elr_mem_pool *pool);
+/*firstlastƬѹڴصĿƬջ*/
+void                _elr_slice_push(elr_mem_pool *pool, elr_mem_slice *first, elr_mem_slice *last);
+/*ǰ߳ڵCPUı*/
+int                 _elr_cpu_index();
+/*ӷƬڴеǰCPUķƬһڴƬ÷ƬѿʱƬ*/
+elr_mem_slice*      _elr_slice_from_shards(elr_mem_pool *pool);
+/*ӵߴڴһڴƬ*/
+elr_mem_slice*      _elr_slice_from_owner(elr_mem_pool *pool);
+/*߳ͷŵƬѹڴصԶͷջ*/
+void                _elr_remote_push(elr_mem_pool *pool, elr_mem_slice *slice);
+/*ӵһȡԶͷջеƬ黹ڴ*/
+void                _elr_remote_drain(elr_mem_pool *pool);
+#endif // ELR_USE_THREAD
 
 /*
 ** ʼڴأڲһȫڴء
@@ -150,10 +590,27 @@ void                _elr_mpl_destory(elr_mem_pool *pool, int inner, int lock_thi
 */
 ELR_MPL_API int elr_mpl_init()
 {
-	int obj_size_count = 13;
-	size_t obj_size[13] = { 64, 98, 128, 192, 256, 384, 512, 768, 1024, 1280, 1536, 1792, 2048 };
+	return elr_mpl_init_ex(0, NULL);
+}
+
+/*
+** ʼڴأָȫֶߴڴصĳߴ
+** obj_sizeΪNULLʱʹĬϵĳߴڴģѾʼʱߴá
+*/
+ELR_MPL_API int elr_mpl_init_ex(int obj_size_count, const size_t* obj_size)
+{
+	size_t default_size[13] = { 64, 98, 128, 192, 256, 384, 512, 768, 1024, 1280, 1536, 1792, 2048 };
+#ifdef ELR_USE_THREAD
+	elr_counter_t refs = 0;
+#endif // ELR_USE_THREAD
+
+	if (obj_size == NULL || obj_size_count <= 0)
+	{
+		obj_size_count = 13;
+		obj_size = default_size;
+	}
 #ifdef ELR_USE_THREAD
-	elr_counter_t refs = elr_atomic_inc(&g_mpl_refs);
+	refs = elr_atomic_inc(&g_mpl_refs);
 	if(refs == 1)
 	{
 #else
@@ -162,12 +619,61 @@ ELR_MPL_API int elr_mpl_init()
 	{
 #endif // ELR_USE_THREAD
 		g_occupation_size = 0;
+#if defined(_WIN32)
+		{
+			SYSTEM_INFO si;
+			GetSystemInfo(&si);
+			g_page_size = si.dwPageSize;
+			g_cpu_count = (int)si.dwNumberOfProcessors;
+		}
+#else
+		g_page_size = (size_t)sysconf(_SC_PAGESIZE);
+		g_cpu_count = (int)sysconf(_SC_NPROCESSORS_CONF);
+#endif
+		if (g_cpu_count < 1)
+			g_cpu_count = 1;
+#ifdef ELR_USE_HISTOGRAM
+#if defined(_WIN32)
+		QueryPerformanceFrequency(&g_perf_freq);
+#endif
+		_elr_latency_reset(&g_mem_pool, 0);
+		g_mem_pool.request_count = 0;
+		g_mem_pool.request_size = 0;
+#endif // ELR_USE_HISTOGRAM
+		/*ϴֹʱȫֶߴڴѾȫڴһ*/
+		g_multi_mem_pool.pool = NULL;
+		g_multi_mem_pool.tag = 0;
 		g_mem_pool.parent = NULL;
 		g_mem_pool.first_child = NULL;
 		g_mem_pool.prev = NULL;
 		g_mem_pool.next = NULL;
 		g_mem_pool.multi = NULL;
 		g_mem_pool.multi_count = 0;
+		g_mem_pool.shards = NULL;
+		g_mem_pool.shard_count = 0;
+		g_mem_pool.class_index = NULL;
+		g_mem_pool.class_index_count = 0;
+		g_mem_pool.class_shift = 0;
+		g_mem_pool.overrange = NULL;
+		g_mem_pool.overrange_capacity = 0;
+		g_mem_pool.overrange_count = 0;
+		g_mem_pool.profiling = 0;
+		g_mem_pool.size_profile = NULL;
+		g_mem_pool.large_size = 0;
+		g_mem_pool.large_pool = NULL;
+		g_mem_pool.large = 0;
+		g_mem_pool.large_cache = NULL;
+		g_mem_pool.large_cache_count = 0;
+		g_mem_pool.huge = 0;
+		g_mem_pool.empty_node_count = 0;
+		g_mem_pool.retain = 0;
+		g_mem_pool.retain_low = 0;
+		g_mem_pool.retain_high = 0;
+		g_mem_pool.live_slice_count = 0;
+		g_mem_pool.peak_slice_count = 0;
+		g_mem_pool.alloc_count = 0;
+		g_mem_pool.free_count = 0;
+		g_mem_pool.node_alloc_count = 0;
 		g_mem_pool.object_size = sizeof(elr_mem_pool);
 		g_mem_pool.slice_size = ELR_ALIGN(sizeof(elr_mem_slice),sizeof(int))
 			+ ELR_ALIGN(sizeof(elr_mem_pool),sizeof(int));
@@ -180,28 +686,88 @@ ELR_MPL_API int elr_mpl_init()
 		g_mem_pool.on_slice_alloc = NULL;
 		g_mem_pool.on_slice_free = NULL;
 		g_mem_pool.first_occupied_slice = NULL;
+		g_mem_pool.track = 0;
 		g_mem_pool.slice_tag = 0;
+		g_mem_pool.compact = 0;
+		g_mem_pool.arena = 0;
+		g_mem_pool.first_free_object = NULL;
+		g_mem_pool.align = 0;
 
 #ifdef ELR_USE_THREAD
 		g_mem_pool.sync = 1;
+		g_mem_pool.cache_size = 0;
+		g_mem_pool.first_cache = NULL;
+		g_mem_pool.lockfree = 0;
+		g_mem_pool.free_stack.ptr = NULL;
+		g_mem_pool.free_stack.tag = 0;
+		g_mem_pool.lockfree_allocs = ELR_ATOMIC_ZERO;
+		g_mem_pool.lockfree_frees = ELR_ATOMIC_ZERO;
+		g_mem_pool.owner_thread = 0;
+		g_mem_pool.remote_free = NULL;
 		if(elr_mtx_init(&g_mem_pool.pool_mutex) == 0)
 		{
 			elr_atomic_dec(&g_mpl_refs);
 			return 0;
 		}
-		g_multi_mem_pool = elr_mpl_create_multi_sync(NULL, obj_size_count, obj_size, NULL, NULL);
+		if (elr_mtx_init(&g_cache_mutex) == 0)
+		{
+			elr_mtx_finalize(&g_mem_pool.pool_mutex);
+			elr_atomic_dec(&g_mpl_refs);
+			return 0;
+		}
+		if (elr_tls_init(&g_cache_key, _elr_thread_exit) == 0)
+		{
+			elr_mtx_finalize(&g_cache_mutex);
+			elr_mtx_finalize(&g_mem_pool.pool_mutex);
+			elr_atomic_dec(&g_mpl_refs);
+			return 0;
+		}
+		if (elr_mtx_init(&g_chunk_mutex) == 0)
+		{
+			elr_tls_finalize(&g_cache_key);
+			elr_mtx_finalize(&g_cache_mutex);
+			elr_mtx_finalize(&g_mem_pool.pool_mutex);
+			elr_atomic_dec(&g_mpl_refs);
+			return 0;
+		}
+		if (elr_mtx_init(&g_tree_mutex) == 0)
+		{
+			elr_mtx_finalize(&g_chunk_mutex);
+			elr_tls_finalize(&g_cache_key);
+			elr_mtx_finalize(&g_cache_mutex);
+			elr_mtx_finalize(&g_mem_pool.pool_mutex);
+			elr_atomic_dec(&g_mpl_refs);
+			return 0;
+		}
+#ifdef ELR_USE_SAMPLING
+		if (elr_mtx_init(&g_sample_mutex) == 0)
+		{
+			elr_mtx_finalize(&g_tree_mutex);
+			elr_mtx_finalize(&g_chunk_mutex);
+			elr_tls_finalize(&g_cache_key);
+			elr_mtx_finalize(&g_cache_mutex);
+			elr_mtx_finalize(&g_mem_pool.pool_mutex);
+			elr_atomic_dec(&g_mpl_refs);
+			return 0;
+		}
+#endif // ELR_USE_SAMPLING
+		g_first_thread_ctx = NULL;
+		g_cache_alive = 1;
+		g_multi_mem_pool = elr_mpl_create_multi_sync(NULL, obj_size_count, (size_t*)obj_size, NULL, NULL);
 		if (g_multi_mem_pool.pool == NULL)
 		{
 			elr_atomic_dec(&g_mpl_refs);
 			return 0;
 		}
+		elr_atomic_inc(&g_mpl_epoch);
 #else
-		g_multi_mem_pool = elr_mpl_create_multi(NULL, obj_size_count, obj_size, NULL, NULL);
+		g_multi_mem_pool = elr_mpl_create_multi(NULL, obj_size_count, (size_t*)obj_size, NULL, NULL);
 		if (g_multi_mem_pool.pool == NULL)
 		{
 			g_mpl_refs--;
 			return 0;
 		}
+		g_mpl_epoch++;
 #endif // ELR_USE_THREAD
 	}
 
@@ -223,7 +789,7 @@ ELR_MPL_API elr_mpl_t elr_mpl_create(elr_mpl_ht fpool,
 	assert(fpool == NULL || elr_mpl_avail(fpool) != 0);
 	
 	pool = _elr_mpl_create(fpool == NULL ? NULL : fpool->pool,
-		obj_size, on_alloc, on_free, 0);
+		obj_size, 0, on_alloc, on_free, 0);
 	if (pool != NULL)
 	{
 		mpl.pool = pool;
@@ -247,7 +813,7 @@ ELR_MPL_API elr_mpl_t elr_mpl_create_sync(elr_mpl_ht fpool,
 	assert(fpool == NULL || elr_mpl_avail(fpool) != 0);
 
 	pool = _elr_mpl_create(fpool == NULL ? NULL : fpool->pool,
-		obj_size, on_alloc, on_free, 1);
+		obj_size, 0, on_alloc, on_free, 1);
 	if (pool != NULL)
 	{
 		mpl.pool = pool;
@@ -257,143 +823,69 @@ ELR_MPL_API elr_mpl_t elr_mpl_create_sync(elr_mpl_ht fpool,
 	return mpl;
 }
 
-/*һڴأָ䵥ԪСsyncִǷ֧ͬ֡*/
-elr_mem_pool* _elr_mpl_create(elr_mem_pool* fpool,
+/*
+** һֺ֧̻߳ͬ߳ڴأָ䵥ԪС
+** δELR_USE_THREADʱͬelr_mpl_create
+*/
+ELR_MPL_API elr_mpl_t elr_mpl_create_cached(elr_mpl_ht fpool,
 	size_t obj_size,
+	size_t cache_size,
 	elr_mpl_callback on_alloc,
-	elr_mpl_callback on_free,
-	int sync)
+	elr_mpl_callback on_free)
 {
-	elr_mem_slice *pslice = NULL;
+	elr_mpl_t      mpl = ELR_MPL_INITIALIZER;
 	elr_mem_pool  *pool = NULL;
 
-	if ((pslice = _elr_slice_from_pool(&g_mem_pool)) == NULL)
-		return NULL;
-	pool = (elr_mem_pool*)((char*)pslice
-		+ ELR_ALIGN(sizeof(elr_mem_slice), sizeof(int)));
+	assert(fpool == NULL || elr_mpl_avail(fpool) != 0);
 
-#ifdef ELR_USE_THREAD	
-	pool->sync = sync;
-	if (sync == 1 && elr_mtx_init(&pool->pool_mutex) == 0)
+	pool = _elr_mpl_create(fpool == NULL ? NULL : fpool->pool,
+		obj_size, 0, on_alloc, on_free, 1);
+	if (pool != NULL)
 	{
-		elr_mpl_free(pool);
-		return NULL;
-	}
-#endif // ELR_USE_THREAD
-	pool->slice_tag = pslice->tag;
-	pool->first_child = NULL;
-	pool->parent = fpool == NULL ? &g_mem_pool : fpool;
-	pool->multi = NULL;
-	pool->multi_count = 0;
-	pool->object_size = obj_size;
-	pool->slice_size = ELR_ALIGN(sizeof(elr_mem_slice), sizeof(int))
-		+ ELR_ALIGN(obj_size, sizeof(int));
-	if (pool->slice_size < ELR_MAX_SLICE_SIZE)
-		pool->slice_count = ELR_MAX_SLICE_COUNT
-		- pool->slice_size*(ELR_MAX_SLICE_COUNT - 1) / ELR_MAX_SLICE_SIZE;
-	else
-		pool->slice_count = 1;
-	pool->node_size = pool->slice_size*pool->slice_count
-		+ ELR_ALIGN(sizeof(elr_mem_node), sizeof(int));
-	pool->first_node = NULL;
-	pool->newly_alloc_node = NULL;
-	pool->first_free_slice = NULL;
-	pool->on_slice_alloc = on_alloc;
-	pool->on_slice_free = on_free;
-	pool->first_occupied_slice = NULL;
-
-#ifdef ELR_USE_THREAD
-	if(pool->parent->sync == 1)
-		elr_mtx_lock(&pool->parent->pool_mutex);
-#endif // ELR_USE_THREAD
-	pool->prev = NULL;
-	pool->next = pool->parent->first_child;
-	if (pool->next != NULL)
-		pool->next->prev = pool;
-	pool->parent->first_child = pool;
 #ifdef ELR_USE_THREAD
-	if (pool->parent->sync == 1)
-		elr_mtx_unlock(&pool->parent->pool_mutex);
+		pool->cache_size = cache_size;
 #endif // ELR_USE_THREAD
+		mpl.pool = pool;
+		mpl.tag = pool->slice_tag;
+	}
 
-	return pool;
+	return mpl;
 }
 
-/*Դ벻ͬСڴڴأsyncִǷ֧ͬ֡*/
-elr_mem_pool* _elr_mpl_create_multi(elr_mem_pool* fpool,
-	int obj_size_count,
-	size_t* obj_size,
+/*
+** һƬڴأָ䵥ԪС
+** δELR_USE_THREADʱͬelr_mpl_create
+*/
+ELR_MPL_API elr_mpl_t elr_mpl_create_lockfree(elr_mpl_ht fpool,
+	size_t obj_size,
 	elr_mpl_callback on_alloc,
-	elr_mpl_callback on_free,
-	int sync)
+	elr_mpl_callback on_free)
 {
-	elr_mem_pool  *first_pool = NULL;
+	elr_mpl_t      mpl = ELR_MPL_INITIALIZER;
 	elr_mem_pool  *pool = NULL;
-	elr_mem_pool **multi_pool = NULL;
-
-	int i = 0;
-	int j = 0;
-	int valid = 1;
-
-	multi_pool = malloc(obj_size_count * sizeof(elr_mem_pool*));
-	if (multi_pool == NULL)
-		return NULL;
-
-	for (i = 0; i < obj_size_count; i++)
-	{
-		pool = _elr_mpl_create(fpool, obj_size[i], on_alloc, on_free, i == 0 ? sync : 0);
-		if (pool == NULL)
-		{
-			valid = 0;
-			break;
-		}
-		multi_pool[i] = (elr_mem_pool*)pool;
-		if (i == 0)
-		{
-			first_pool = pool;
-			pool->multi = multi_pool;
-			pool->multi_count = obj_size_count;
-		}
-	}
 
-	if (valid == 1)
-	{
-		//g_multi_mem_poolҲͨģ
-		//Ҫg_multi_mem_pool
-		//g_multi_mem_poolû룬ʱЧ
-		if (g_multi_mem_pool.pool == NULL)
-		{
-			g_multi_mem_pool.pool = first_pool;
-			g_multi_mem_pool.tag = first_pool->slice_tag;
-		}
-		multi_pool[0]->multi = (elr_mem_pool**)elr_mpl_alloc_multi(&g_multi_mem_pool, obj_size_count * sizeof(elr_mem_pool*));
-		if (multi_pool[0]->multi != NULL)
-		{
-			memcpy(multi_pool[0]->multi, multi_pool, obj_size_count * sizeof(elr_mem_pool*));
-		}
-		else
-		{
-			valid = 0;
-		}
-	}
+	assert(fpool == NULL || elr_mpl_avail(fpool) != 0);
 
-	if (valid == 0)
+	pool = _elr_mpl_create(fpool == NULL ? NULL : fpool->pool,
+		obj_size, 0, on_alloc, on_free, 1);
+	if (pool != NULL)
 	{
-		first_pool = NULL;
-		for (j = 0; j < i; j++)
-		{
-			_elr_mpl_destory(multi_pool[j], 0, 0);
-		}
+#ifdef ELR_USE_THREAD
+		assert(((size_t)&pool->free_stack) % sizeof(elr_tagged_ptr) == 0);
+		pool->lockfree = 1;
+#endif // ELR_USE_THREAD
+		mpl.pool = pool;
+		mpl.tag = pool->slice_tag;
 	}
 
-	free(multi_pool);
-
-	return first_pool;
+	return mpl;
 }
 
-ELR_MPL_API elr_mpl_t elr_mpl_create_multi(elr_mpl_ht fpool,
-	int obj_size_count,
-	size_t* obj_size,
+/*
+** һڵǰ̵߳ڴأָ䵥ԪС
+*/
+ELR_MPL_API elr_mpl_t elr_mpl_create_owned(elr_mpl_ht fpool,
+	size_t obj_size,
 	elr_mpl_callback on_alloc,
 	elr_mpl_callback on_free)
 {
@@ -402,10 +894,15 @@ ELR_MPL_API elr_mpl_t elr_mpl_create_multi(elr_mpl_ht fpool,
 
 	assert(fpool == NULL || elr_mpl_avail(fpool) != 0);
 
-	pool = _elr_mpl_create_multi(fpool == NULL ? NULL : fpool->pool,
-		obj_size_count, obj_size, on_alloc, on_free, 0);
+	pool = _elr_mpl_create(fpool == NULL ? NULL : fpool->pool,
+		obj_size, 0, on_alloc, on_free, 1);
 	if (pool != NULL)
 	{
+#ifdef ELR_USE_THREAD
+		pool->owner_thread = elr_thread_self();
+		/*ƬƬУ߳ͷʱҪʹnext*/
+		pool->track = 0;
+#endif // ELR_USE_THREAD
 		mpl.pool = pool;
 		mpl.tag = pool->slice_tag;
 	}
@@ -413,249 +910,3487 @@ ELR_MPL_API elr_mpl_t elr_mpl_create_multi(elr_mpl_ht fpool,
 	return mpl;
 }
 
-ELR_MPL_API elr_mpl_t elr_mpl_create_multi_sync(elr_mpl_ht fpool,
-	int obj_size_count,
-	size_t* obj_size,
+/*
+** һCPUƬڴأָ䵥ԪС
+** ÿCPUһƬƬǴͬڴء
+*/
+ELR_MPL_API elr_mpl_t elr_mpl_create_sharded(elr_mpl_ht fpool,
+	size_t obj_size,
 	elr_mpl_callback on_alloc,
 	elr_mpl_callback on_free)
 {
 	elr_mpl_t      mpl = ELR_MPL_INITIALIZER;
 	elr_mem_pool  *pool = NULL;
+#ifdef ELR_USE_THREAD
+	elr_mem_pool **shards = NULL;
+	int            i = 0;
+#endif // ELR_USE_THREAD
 
 	assert(fpool == NULL || elr_mpl_avail(fpool) != 0);
-	
-	pool = _elr_mpl_create_multi(fpool == NULL ? NULL : fpool->pool,
-		obj_size_count, obj_size, on_alloc, on_free, 1);
-	if (pool != NULL)
+
+	pool = _elr_mpl_create(fpool == NULL ? NULL : fpool->pool,
+		obj_size, 0, on_alloc, on_free, 1);
+	if (pool == NULL)
+		return mpl;
+
+#ifdef ELR_USE_THREAD
+	shards = (elr_mem_pool**)elr_mpl_alloc_multi(&g_multi_mem_pool,
+		g_cpu_count * sizeof(elr_mem_pool*));
+	for (i = 0; shards != NULL && i < g_cpu_count; i++)
 	{
-		mpl.pool = pool;
-		mpl.tag = pool->slice_tag;
+		shards[i] = _elr_mpl_create(pool, obj_size, 0, on_alloc, on_free, 1);
+		if (shards[i] == NULL)
+			break;
 	}
 
+	/*ѴķƬڴһ*/
+	if (shards == NULL || i < g_cpu_count)
+	{
+		if (shards != NULL)
+			elr_mpl_free(shards);
+		elr_mtx_lock(&g_tree_mutex);
+		_elr_mpl_destory(pool, 0, 0);
+		elr_mtx_unlock(&g_tree_mutex);
+		return mpl;
+	}
+	pool->shards = shards;
+	pool->shard_count = g_cpu_count;
+#endif // ELR_USE_THREAD
+
+	mpl.pool = pool;
+	mpl.tag = pool->slice_tag;
 	return mpl;
 }
 
 /*
-** жڴǷЧģһڴɺá
-** 0ʾЧ
-** poolΪNULL
+** ǰ߳Ϊڴصӵߡ
 */
-ELR_MPL_API int  elr_mpl_avail(elr_mpl_ht hpool)
+ELR_MPL_API void elr_mpl_set_owner(elr_mpl_ht hpool)
 {
-	int              ret = 1;
-	elr_mem_slice   *pslice = NULL;
-	elr_mem_pool    *pool = NULL;
+#ifdef ELR_USE_THREAD
+	elr_mem_pool  *pool = NULL;
 
-	assert(hpool != NULL);
+	assert(hpool != NULL && elr_mpl_avail(hpool) != 0);
 
-	if(hpool->pool == NULL)
+	pool = (elr_mem_pool*)hpool->pool;
+	assert(pool->owner_thread != 0);
+	pool->owner_thread = elr_thread_self();
+#else
+	assert(hpool != NULL && elr_mpl_avail(hpool) != 0);
+#endif // ELR_USE_THREAD
+}
+
+/*
+** һڴûƬͷĽڴأָ䵥ԪС
+*/
+ELR_MPL_API elr_mpl_t elr_mpl_create_compact(elr_mpl_ht fpool,
+	size_t obj_size,
+	elr_mpl_callback on_alloc,
+	elr_mpl_callback on_free)
+{
+	elr_mpl_t      mpl = ELR_MPL_INITIALIZER;
+	elr_mem_pool  *pool = NULL;
+
+	assert(fpool == NULL || elr_mpl_avail(fpool) != 0);
+
+	pool = _elr_mpl_create(fpool == NULL ? NULL : fpool->pool,
+		obj_size, 0, on_alloc, on_free, 0);
+	if (pool != NULL)
+	{
+		_elr_mpl_set_compact(pool);
+		mpl.pool = pool;
+		mpl.tag = pool->slice_tag;
+	}
+
+	return mpl;
+}
+
+/*
+** һֵ֧߳ͬĽڴأָ䵥ԪС
+*/
+ELR_MPL_API elr_mpl_t elr_mpl_create_compact_sync(elr_mpl_ht fpool,
+	size_t obj_size,
+	elr_mpl_callback on_alloc,
+	elr_mpl_callback on_free)
+{
+	elr_mpl_t      mpl = ELR_MPL_INITIALIZER;
+	elr_mem_pool  *pool = NULL;
+
+	assert(fpool == NULL || elr_mpl_avail(fpool) != 0);
+
+	pool = _elr_mpl_create(fpool == NULL ? NULL : fpool->pool,
+		obj_size, 0, on_alloc, on_free, 1);
+	if (pool != NULL)
+	{
+		_elr_mpl_set_compact(pool);
+		mpl.pool = pool;
+		mpl.tag = pool->slice_tag;
+	}
+
+	return mpl;
+}
+
+/*
+** һڴأָĬϵķ䵥ԪС
+*/
+ELR_MPL_API elr_mpl_t elr_mpl_create_arena(elr_mpl_ht fpool, size_t obj_size)
+{
+	elr_mpl_t      mpl = ELR_MPL_INITIALIZER;
+	elr_mem_pool  *pool = NULL;
+
+	assert(fpool == NULL || elr_mpl_avail(fpool) != 0);
+
+	pool = _elr_mpl_create(fpool == NULL ? NULL : fpool->pool,
+		obj_size, 0, NULL, NULL, 0);
+	if (pool != NULL)
+	{
+		_elr_mpl_set_arena(pool);
+		mpl.pool = pool;
+		mpl.tag = pool->slice_tag;
+	}
+
+	return mpl;
+}
+
+/*
+** һֵ֧߳ͬľڴأָĬϵķ䵥ԪС
+*/
+ELR_MPL_API elr_mpl_t elr_mpl_create_arena_sync(elr_mpl_ht fpool, size_t obj_size)
+{
+	elr_mpl_t      mpl = ELR_MPL_INITIALIZER;
+	elr_mem_pool  *pool = NULL;
+
+	assert(fpool == NULL || elr_mpl_avail(fpool) != 0);
+
+	pool = _elr_mpl_create(fpool == NULL ? NULL : fpool->pool,
+		obj_size, 0, NULL, NULL, 1);
+	if (pool != NULL)
+	{
+		_elr_mpl_set_arena(pool);
+		mpl.pool = pool;
+		mpl.tag = pool->slice_tag;
+	}
+
+	return mpl;
+}
+
+/*
+** һڴ鰴ָֽڴأָ䵥ԪС
+*/
+ELR_MPL_API elr_mpl_t elr_mpl_create_aligned(elr_mpl_ht fpool,
+	size_t obj_size,
+	size_t align,
+	elr_mpl_callback on_alloc,
+	elr_mpl_callback on_free)
+{
+	elr_mpl_t      mpl = ELR_MPL_INITIALIZER;
+	elr_mem_pool  *pool = NULL;
+
+	assert(fpool == NULL || elr_mpl_avail(fpool) != 0);
+
+	pool = _elr_mpl_create(fpool == NULL ? NULL : fpool->pool,
+		obj_size, align, on_alloc, on_free, 0);
+	if (pool != NULL)
+	{
+		mpl.pool = pool;
+		mpl.tag = pool->slice_tag;
+	}
+
+	return mpl;
+}
+
+/*
+** һ֧߳ͬ֡ڴ鰴ָֽڴأָ䵥ԪС
+*/
+ELR_MPL_API elr_mpl_t elr_mpl_create_aligned_sync(elr_mpl_ht fpool,
+	size_t obj_size,
+	size_t align,
+	elr_mpl_callback on_alloc,
+	elr_mpl_callback on_free)
+{
+	elr_mpl_t      mpl = ELR_MPL_INITIALIZER;
+	elr_mem_pool  *pool = NULL;
+
+	assert(fpool == NULL || elr_mpl_avail(fpool) != 0);
+
+	pool = _elr_mpl_create(fpool == NULL ? NULL : fpool->pool,
+		obj_size, align, on_alloc, on_free, 1);
+	if (pool != NULL)
+	{
+		mpl.pool = pool;
+		mpl.tag = pool->slice_tag;
+	}
+
+	return mpl;
+}
+
+/*
+** һڴأָ䵥ԪСsyncִǷ֧ͬ֡
+** alignΪ0ʱ2ݣڴƬĲalign
+** ڴڵ㰴align룬ҵһڴƬλʹڴ鰴align롣
+*/
+elr_mem_pool* _elr_mpl_create(elr_mem_pool* fpool,
+	size_t obj_size,
+	size_t align,
+	elr_mpl_callback on_alloc,
+	elr_mpl_callback on_free,
+	int sync)
+{
+	elr_mem_slice *pslice = NULL;
+	elr_mem_pool  *pool = NULL;
+
+	assert((align & (align - 1)) == 0);
+	if ((align & (align - 1)) != 0)
+		return NULL;
+	if (align <= sizeof(int))
+		align = 0;
+
+	if ((pslice = _elr_slice_from_pool(&g_mem_pool)) == NULL)
+		return NULL;
+	pool = (elr_mem_pool*)((char*)pslice
+		+ ELR_ALIGN(sizeof(elr_mem_slice), sizeof(int)));
+
+#ifdef ELR_USE_THREAD	
+	pool->sync = sync;
+	pool->cache_size = 0;
+	pool->first_cache = NULL;
+	pool->lockfree = 0;
+	pool->free_stack.ptr = NULL;
+	pool->free_stack.tag = 0;
+	pool->lockfree_allocs = ELR_ATOMIC_ZERO;
+	pool->lockfree_frees = ELR_ATOMIC_ZERO;
+	pool->owner_thread = 0;
+	pool->remote_free = NULL;
+	if (sync == 1 && elr_mtx_init(&pool->pool_mutex) == 0)
+	{
+		elr_mpl_free(pool);
+		return NULL;
+	}
+#endif // ELR_USE_THREAD
+#ifdef ELR_USE_HISTOGRAM
+	_elr_latency_reset(pool, 0);
+	pool->request_count = 0;
+	pool->request_size = 0;
+#endif // ELR_USE_HISTOGRAM
+	pool->slice_tag = pslice->tag;
+	pool->first_child = NULL;
+	pool->parent = fpool == NULL ? &g_mem_pool : fpool;
+	pool->multi = NULL;
+	pool->multi_count = 0;
+	pool->shards = NULL;
+	pool->shard_count = 0;
+	pool->class_index = NULL;
+	pool->class_index_count = 0;
+	pool->class_shift = 0;
+	pool->overrange = NULL;
+	pool->overrange_capacity = 0;
+	pool->overrange_count = 0;
+	pool->profiling = 0;
+	pool->size_profile = NULL;
+	pool->large_size = 0;
+	pool->large_pool = NULL;
+	pool->large = 0;
+	pool->large_cache = NULL;
+	pool->large_cache_count = 0;
+	pool->huge = 0;
+	pool->empty_node_count = 0;
+	pool->retain = 0;
+	pool->retain_low = 0;
+	pool->retain_high = 0;
+	pool->live_slice_count = 0;
+	pool->peak_slice_count = 0;
+	pool->alloc_count = 0;
+	pool->free_count = 0;
+	pool->node_alloc_count = 0;
+	pool->object_size = obj_size;
+	pool->align = align;
+	pool->slice_size = ELR_ALIGN(sizeof(elr_mem_slice), sizeof(int))
+		+ ELR_ALIGN(obj_size, sizeof(int));
+	if (align > 0)
+		pool->slice_size = ELR_ALIGN(pool->slice_size, align);
+	if (pool->slice_size < ELR_MAX_SLICE_SIZE)
+		pool->slice_count = ELR_MAX_SLICE_COUNT
+		- pool->slice_size*(ELR_MAX_SLICE_COUNT - 1) / ELR_MAX_SLICE_SIZE;
+	else
+		pool->slice_count = 1;
+	pool->compact = 0;
+	pool->arena = 0;
+	pool->node_size = pool->slice_size*pool->slice_count
+		+ _elr_node_head(pool);
+	pool->first_node = NULL;
+	pool->newly_alloc_node = NULL;
+	pool->first_free_slice = NULL;
+	pool->on_slice_alloc = on_alloc;
+	pool->on_slice_free = on_free;
+	pool->first_occupied_slice = NULL;
+	pool->track = on_free != NULL ? 1 : 0;
+	pool->first_free_object = NULL;
+
+#ifdef ELR_USE_THREAD
+	if(pool->parent->sync == 1)
+		elr_mtx_lock(&pool->parent->pool_mutex);
+#endif // ELR_USE_THREAD
+	pool->prev = NULL;
+	pool->next = pool->parent->first_child;
+	if (pool->next != NULL)
+		pool->next->prev = pool;
+	pool->parent->first_child = pool;
+#ifdef ELR_USE_THREAD
+	if (pool->parent->sync == 1)
+		elr_mtx_unlock(&pool->parent->pool_mutex);
+#endif // ELR_USE_THREAD
+
+	return pool;
+}
+
+/*
+** մڴΪڴء
+** ڴ鰴ָС룬ڴڵҪELR_COMPACT_MIN_SLICE_COUNTڴ顣
+*/
+void _elr_mpl_set_compact(elr_mem_pool* pool)
+{
+	size_t slice_size = ELR_ALIGN(pool->object_size < sizeof(void*)
+		? sizeof(void*) : pool->object_size, sizeof(void*));
+	size_t slice_count = (ELR_COMPACT_NODE_SIZE - ELR_COMPACT_NODE_HEAD) / slice_size;
+
+	if (slice_count < ELR_COMPACT_MIN_SLICE_COUNT)
+		return;
+
+	pool->compact = 1;
+	pool->slice_size = slice_size;
+	pool->slice_count = slice_count;
+	pool->node_size = ELR_COMPACT_NODE_SIZE;
+}
+
+/*
+** մڴΪڴء
+** ĬϵڴڵELR_COMPACT_MIN_SLICE_COUNTĬϴСڴ飬
+** СȡELR_ARENA_NODE_SIZE
+*/
+void _elr_mpl_set_arena(elr_mem_pool* pool)
+{
+	size_t slice_size = ELR_ALIGN(pool->object_size == 0
+		? 1 : pool->object_size, ELR_MALLOC_ALIGN);
+
+	pool->arena = 1;
+	pool->slice_size = slice_size;
+	pool->node_size = ELR_ALIGN(ELR_ARENA_NODE_HEAD
+		+ slice_size * ELR_COMPACT_MIN_SLICE_COUNT, ELR_ARENA_NODE_SIZE);
+	pool->slice_count = (pool->node_size - ELR_ARENA_NODE_HEAD) / slice_size;
+}
+
+/*Դ벻ͬСڴڴأsyncִǷ֧ͬ֡*/
+elr_mem_pool* _elr_mpl_create_multi(elr_mem_pool* fpool,
+	int obj_size_count,
+	size_t* obj_size,
+	size_t align,
+	elr_mpl_callback on_alloc,
+	elr_mpl_callback on_free,
+	int sync)
+{
+	elr_mem_pool  *first_pool = NULL;
+	elr_mem_pool  *pool = NULL;
+	elr_mem_pool **multi_pool = NULL;
+
+	int i = 0;
+	int j = 0;
+	int valid = 1;
+
+	multi_pool = malloc(obj_size_count * sizeof(elr_mem_pool*));
+	if (multi_pool == NULL)
+		return NULL;
+
+	for (i = 0; i < obj_size_count; i++)
+	{
+		pool = _elr_mpl_create(fpool, obj_size[i], align, on_alloc, on_free, sync);
+		if (pool == NULL)
+		{
+			valid = 0;
+			break;
+		}
+		multi_pool[i] = (elr_mem_pool*)pool;
+		if (i == 0)
+		{
+			first_pool = pool;
+			pool->multi = multi_pool;
+			pool->multi_count = obj_size_count;
+		}
+	}
+
+	if (valid == 1)
+	{
+		//g_multi_mem_poolҲͨģ
+		//Ҫg_multi_mem_pool
+		//g_multi_mem_poolû룬ʱЧ
+		if (g_multi_mem_pool.pool == NULL)
+		{
+			g_multi_mem_pool.pool = first_pool;
+			g_multi_mem_pool.tag = first_pool->slice_tag;
+		}
+		multi_pool[0]->multi = (elr_mem_pool**)elr_mpl_alloc_multi(&g_multi_mem_pool, obj_size_count * sizeof(elr_mem_pool*));
+		if (multi_pool[0]->multi != NULL)
+		{
+			memcpy(multi_pool[0]->multi, multi_pool, obj_size_count * sizeof(elr_mem_pool*));
+			multi_pool[0]->large_size = ELR_LARGE_OBJECT_SIZE;
+			valid = _elr_class_index_build(multi_pool[0]);
+		}
+		else
+		{
+			valid = 0;
+		}
+	}
+
+	if (valid == 0)
+	{
+		first_pool = NULL;
+#ifdef ELR_USE_THREAD
+		elr_mtx_lock(&g_tree_mutex);
+#endif // ELR_USE_THREAD
+		for (j = 0; j < i; j++)
+		{
+			_elr_mpl_destory(multi_pool[j], 0, 0);
+		}
+#ifdef ELR_USE_THREAD
+		elr_mtx_unlock(&g_tree_mutex);
+#endif // ELR_USE_THREAD
+	}
+
+	free(multi_pool);
+
+	return first_pool;
+}
+
+ELR_MPL_API elr_mpl_t elr_mpl_create_multi(elr_mpl_ht fpool,
+	int obj_size_count,
+	size_t* obj_size,
+	elr_mpl_callback on_alloc,
+	elr_mpl_callback on_free)
+{
+	elr_mpl_t      mpl = ELR_MPL_INITIALIZER;
+	elr_mem_pool  *pool = NULL;
+
+	assert(fpool == NULL || elr_mpl_avail(fpool) != 0);
+
+	pool = _elr_mpl_create_multi(fpool == NULL ? NULL : fpool->pool,
+		obj_size_count, obj_size, 0, on_alloc, on_free, 0);
+	if (pool != NULL)
+	{
+		mpl.pool = pool;
+		mpl.tag = pool->slice_tag;
+	}
+
+	return mpl;
+}
+
+ELR_MPL_API elr_mpl_t elr_mpl_create_multi_sync(elr_mpl_ht fpool,
+	int obj_size_count,
+	size_t* obj_size,
+	elr_mpl_callback on_alloc,
+	elr_mpl_callback on_free)
+{
+	elr_mpl_t      mpl = ELR_MPL_INITIALIZER;
+	elr_mem_pool  *pool = NULL;
+
+	assert(fpool == NULL || elr_mpl_avail(fpool) != 0);
+	
+	pool = _elr_mpl_create_multi(fpool == NULL ? NULL : fpool->pool,
+		obj_size_count, obj_size, 0, on_alloc, on_free, 1);
+	if (pool != NULL)
+	{
+		mpl.pool = pool;
+		mpl.tag = pool->slice_tag;
+	}
+
+	return mpl;
+}
+
+/*
+** Դ벻ͬСڴڴأڴ鰴ָֽ롣
+*/
+ELR_MPL_API elr_mpl_t elr_mpl_create_multi_aligned(elr_mpl_ht fpool,
+	int obj_size_count,
+	size_t* obj_size,
+	size_t align,
+	elr_mpl_callback on_alloc,
+	elr_mpl_callback on_free)
+{
+	elr_mpl_t      mpl = ELR_MPL_INITIALIZER;
+	elr_mem_pool  *pool = NULL;
+
+	assert(fpool == NULL || elr_mpl_avail(fpool) != 0);
+
+	pool = _elr_mpl_create_multi(fpool == NULL ? NULL : fpool->pool,
+		obj_size_count, obj_size, align, on_alloc, on_free, 0);
+	if (pool != NULL)
+	{
+		mpl.pool = pool;
+		mpl.tag = pool->slice_tag;
+	}
+
+	return mpl;
+}
+
+/*
+** Դ벻ͬСڴĲ֧߳ͬڴأڴ鰴ָֽ롣
+*/
+ELR_MPL_API elr_mpl_t elr_mpl_create_multi_aligned_sync(elr_mpl_ht fpool,
+	int obj_size_count,
+	size_t* obj_size,
+	size_t align,
+	elr_mpl_callback on_alloc,
+	elr_mpl_callback on_free)
+{
+	elr_mpl_t      mpl = ELR_MPL_INITIALIZER;
+	elr_mem_pool  *pool = NULL;
+
+	assert(fpool == NULL || elr_mpl_avail(fpool) != 0);
+
+	pool = _elr_mpl_create_multi(fpool == NULL ? NULL : fpool->pool,
+		obj_size_count, obj_size, align, on_alloc, on_free, 1);
+	if (pool != NULL)
+	{
+		mpl.pool = pool;
+		mpl.tag = pool->slice_tag;
+	}
+
+	return mpl;
+}
+
+/*
+** ȡһʹʱڴأģÿγʼһεʱcreate
+*/
+ELR_MPL_API elr_mpl_ht elr_mpl_lazy(elr_mpl_lazy_t* lazy, elr_mpl_factory create, void* arg)
+{
+	elr_mpl_ht  hpool = NULL;
+	int         epoch = 0;
+
+	assert(lazy != NULL && create != NULL);
+
+#ifdef ELR_USE_THREAD
+	/*g_mpl_epochΪ0ʱg_tree_mutexѾʼ*/
+	epoch = (int)elr_atomic_load(&g_mpl_epoch);
+	if (epoch == 0)
+		return NULL;
+	if (elr_atomic_load_int(&lazy->epoch) == epoch)
+		return &lazy->mpl;
+
+	/*g_tree_mutexκڴصȡڴʱԳ*/
+	elr_mtx_lock(&g_tree_mutex);
+	if (lazy->epoch != epoch)
+	{
+		lazy->mpl = create(arg);
+		if (elr_mpl_avail(&lazy->mpl) != 0)
+			elr_atomic_store_int(&lazy->epoch, epoch);
+	}
+	if (lazy->epoch == epoch)
+		hpool = &lazy->mpl;
+	elr_mtx_unlock(&g_tree_mutex);
+#else
+	epoch = g_mpl_epoch;
+	if (epoch == 0)
+		return NULL;
+	if (lazy->epoch != epoch)
+	{
+		lazy->mpl = create(arg);
+		if (elr_mpl_avail(&lazy->mpl) != 0)
+			lazy->epoch = epoch;
+	}
+	if (lazy->epoch == epoch)
+		hpool = &lazy->mpl;
+#endif // ELR_USE_THREAD
+
+	return hpool;
+}
+
+/*
+** жڴǷЧģһڴɺá
+** 0ʾЧ
+** poolΪNULL
+*/
+ELR_MPL_API int  elr_mpl_avail(elr_mpl_ht hpool)
+{
+	int              ret = 1;
+	elr_mem_slice   *pslice = NULL;
+	elr_mem_pool    *pool = NULL;
+
+	assert(hpool != NULL);
+
+	if(hpool->pool == NULL)
+	{
+		ret = 0;
+	}
+	else
+	{
+		pool = (elr_mem_pool*)hpool->pool;
+		pslice = (elr_mem_slice*)((char*)pool
+			- ELR_ALIGN(sizeof(elr_mem_slice),sizeof(int)));
+		if (hpool->tag != pool->slice_tag 
+			|| hpool->tag != pslice->tag)
+			ret = 0;
+	}
+
+	return ret;
+}
+
+int _elr_mpl_avail(elr_mem_pool* pool)
+{
+	elr_mem_slice* pslice = NULL;
+	assert(pool != NULL);
+
+	/*ȫڴزǴڴƬз*/
+	if (pool == &g_mem_pool)
+		return 1;
+
+	pslice = (elr_mem_slice*)((char*)pool
+		- ELR_ALIGN(sizeof(elr_mem_slice), sizeof(int)));
+
+	if (pool->slice_tag != pslice->tag)
+		return 0;
+
+	return 1;
+}
+
+/*
+** ڴڴ档
+*/
+ELR_MPL_API void*  elr_mpl_alloc(elr_mpl_ht hpool)
+{
+	elr_mem_pool  *pool = NULL;
+	void          *mem = NULL;
+#ifdef ELR_USE_HISTOGRAM
+	unsigned long long start = 0;
+#endif // ELR_USE_HISTOGRAM
+
+	assert(hpool != NULL && elr_mpl_avail(hpool)!=0);
+
+	pool = (elr_mem_pool*)hpool->pool;
+#ifdef ELR_USE_HISTOGRAM
+	start = _elr_now();
+	mem = _elr_mpl_alloc(pool);
+	_elr_latency_add(pool, ELR_MPL_LATENCY_ALLOC, _elr_now() - start);
+#else
+	mem = _elr_mpl_alloc(pool);
+#endif // ELR_USE_HISTOGRAM
+#ifdef ELR_USE_SAMPLING
+	if (g_sample_rate != 0 && mem != NULL)
+		_elr_sample_alloc(pool, mem, pool->object_size);
+#endif // ELR_USE_SAMPLING
+
+	return mem;
+}
+
+/*
+** ڴһڴ档
+*/
+ELR_MPL_API void*  elr_mpl_calloc(elr_mpl_ht hpool)
+{
+	elr_mem_pool  *pool = NULL;
+	void          *mem = NULL;
+#ifdef ELR_USE_HISTOGRAM
+	unsigned long long start = 0;
+#endif // ELR_USE_HISTOGRAM
+
+	assert(hpool != NULL && elr_mpl_avail(hpool) != 0);
+
+	pool = (elr_mem_pool*)hpool->pool;
+#ifdef ELR_USE_HISTOGRAM
+	start = _elr_now();
+#endif // ELR_USE_HISTOGRAM
+	mem = _elr_mpl_take(pool);
+	if (mem != NULL)
+	{
+		_elr_zero(mem, pool->object_size);
+		if (pool->on_slice_alloc != NULL)
+			pool->on_slice_alloc(mem);
+	}
+#ifdef ELR_USE_HISTOGRAM
+	_elr_latency_add(pool, ELR_MPL_LATENCY_ALLOC, _elr_now() - start);
+#endif // ELR_USE_HISTOGRAM
+#ifdef ELR_USE_SAMPLING
+	if (g_sample_rate != 0 && mem != NULL)
+		_elr_sample_alloc(pool, mem, pool->object_size);
+#endif // ELR_USE_SAMPLING
+
+	return mem;
+}
+
+/*
+** ڴһڴ飬ִص
+*/
+void* _elr_mpl_alloc(elr_mem_pool* pool)
+{
+	void *mem = _elr_mpl_take(pool);
+
+	if (mem != NULL && pool->on_slice_alloc != NULL)
+		pool->on_slice_alloc(mem);
+
+	return mem;
+}
+
+/*
+** ڴȡһڴ飬ɵִص
+*/
+void* _elr_mpl_take(elr_mem_pool* pool)
+{
+	elr_mem_slice *pslice = NULL;
+
+	if (pool->arena == 1)
+	{
+		void *mem = NULL;
+#ifdef ELR_USE_THREAD
+		if (pool->sync == 1)
+			_elr_mpl_lock(pool);
+#endif // ELR_USE_THREAD
+		mem = _elr_arena_alloc(pool, pool->object_size);
+		if (mem != NULL)
+			pool->alloc_count++;
+#ifdef ELR_USE_THREAD
+		if (pool->sync == 1)
+			elr_mtx_unlock(&pool->pool_mutex);
+#endif // ELR_USE_THREAD
+		return mem;
+	}
+
+	if (pool->compact == 1)
+	{
+		void *mem = NULL;
+#ifdef ELR_USE_THREAD
+		if (pool->sync == 1)
+			_elr_mpl_lock(pool);
+#endif // ELR_USE_THREAD
+		mem = _elr_compact_take(pool);
+		if (mem != NULL)
+			pool->alloc_count++;
+#ifdef ELR_USE_THREAD
+		if (pool->sync == 1)
+			elr_mtx_unlock(&pool->pool_mutex);
+#endif // ELR_USE_THREAD
+		return mem;
+	}
+
+#ifdef ELR_USE_THREAD
+	if (pool->lockfree == 1)
+		pslice = _elr_slice_pop(pool);
+	else if (pool->shards != NULL)
+		pslice = _elr_slice_from_shards(pool);
+	else if (pool->owner_thread != 0)
+		pslice = _elr_slice_from_owner(pool);
+	else if (pool->cache_size > 0)
+		pslice = _elr_slice_from_cache(pool);
+	else
+#endif // ELR_USE_THREAD
+	pslice = _elr_slice_from_pool(pool);
+
+    if(pslice == NULL)
+        return NULL;
+
+    return (char*)pslice + ELR_ALIGN(sizeof(elr_mem_slice),sizeof(int));
+}
+
+/*
+** ӾڴָСڴ档
+*/
+ELR_MPL_API void* elr_mpl_alloc_arena(elr_mpl_ht hpool, size_t size)
+{
+	elr_mem_pool  *pool = NULL;
+	void          *mem = NULL;
+#ifdef ELR_USE_HISTOGRAM
+	unsigned long long start = _elr_now();
+#endif // ELR_USE_HISTOGRAM
+
+	assert(hpool != NULL && elr_mpl_avail(hpool) != 0);
+
+	pool = (elr_mem_pool*)hpool->pool;
+	assert(pool->arena == 1);
+
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		_elr_mpl_lock(pool);
+#endif // ELR_USE_THREAD
+	mem = _elr_arena_alloc(pool, size);
+	if (mem != NULL)
+		pool->alloc_count++;
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		elr_mtx_unlock(&pool->pool_mutex);
+#endif // ELR_USE_THREAD
+#ifdef ELR_USE_HISTOGRAM
+	_elr_latency_add(pool, ELR_MPL_LATENCY_ALLOC, _elr_now() - start);
+#endif // ELR_USE_HISTOGRAM
+
+	return mem;
+}
+
+/*
+** þڴأ˵һڴڵĿͷ
+*/
+ELR_MPL_API void elr_mpl_reset(elr_mpl_ht hpool)
+{
+	elr_mpl_mark_t mark = { NULL, NULL, 0 };
+
+	elr_mpl_rewind(hpool, &mark);
+}
+
+/*
+** ¾ڴصǰĻλúڴ
+*/
+ELR_MPL_API void elr_mpl_mark(elr_mpl_ht hpool, elr_mpl_mark_t* mark)
+{
+	elr_mem_pool  *pool = NULL;
+
+	assert(hpool != NULL && elr_mpl_avail(hpool) != 0);
+	assert(mark != NULL);
+
+	pool = (elr_mem_pool*)hpool->pool;
+	assert(pool->arena == 1);
+
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		_elr_mpl_lock(pool);
+#endif // ELR_USE_THREAD
+	mark->node = pool->newly_alloc_node;
+	mark->avail = pool->newly_alloc_node == NULL ? NULL : pool->newly_alloc_node->first_avail;
+	mark->count = pool->live_slice_count;
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		elr_mtx_unlock(&pool->pool_mutex);
+#endif // ELR_USE_THREAD
+}
+
+/*
+** ڴػ˵markµλá
+*/
+ELR_MPL_API void elr_mpl_rewind(elr_mpl_ht hpool, const elr_mpl_mark_t* mark)
+{
+	elr_mem_pool  *pool = NULL;
+
+	assert(hpool != NULL && elr_mpl_avail(hpool) != 0);
+	assert(mark != NULL);
+
+	pool = (elr_mem_pool*)hpool->pool;
+	assert(pool->arena == 1);
+
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		_elr_mpl_lock(pool);
+#endif // ELR_USE_THREAD
+	_elr_arena_rewind(pool, mark);
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		elr_mtx_unlock(&pool->pool_mutex);
+#endif // ELR_USE_THREAD
+}
+
+ELR_MPL_API void * elr_mpl_alloc_multi(elr_mpl_ht hpool, size_t size)
+{
+	elr_mpl_t      alloc_mpl = ELR_MPL_INITIALIZER;
+	elr_mem_pool  *alloc_pool = NULL;
+
+	assert(hpool == NULL || elr_mpl_avail(hpool) != 0);
+
+	if (hpool == NULL)
+		hpool = &g_multi_mem_pool;
+
+	alloc_pool = _elr_multi_pool_of((elr_mem_pool*)hpool->pool, size);
+	if (alloc_pool == NULL)
+		return NULL;
+
+	if (alloc_pool->large == 1)
+	{
+		void *mem = NULL;
+#ifdef ELR_USE_HISTOGRAM
+		unsigned long long start = _elr_now();
+		mem = _elr_large_alloc(alloc_pool, size, 0);
+		_elr_latency_add(alloc_pool, ELR_MPL_LATENCY_ALLOC, _elr_now() - start);
+#else
+		mem = _elr_large_alloc(alloc_pool, size, 0);
+#endif // ELR_USE_HISTOGRAM
+#ifdef ELR_USE_SAMPLING
+		if (g_sample_rate != 0 && mem != NULL)
+			_elr_sample_alloc(alloc_pool, mem, size);
+#endif // ELR_USE_SAMPLING
+		return mem;
+	}
+
+	alloc_mpl.pool = alloc_pool;
+	alloc_mpl.tag = alloc_pool->slice_tag;
+#ifdef ELR_USE_HISTOGRAM
+	_elr_request_add(alloc_pool, size);
+#endif // ELR_USE_HISTOGRAM
+	return elr_mpl_alloc(&alloc_mpl);
+}
+
+/*
+** ӶߴڴָСڴ档
+** ӳĴڴ鱾㣬㡣
+*/
+ELR_MPL_API void * elr_mpl_calloc_multi(elr_mpl_ht hpool, size_t size)
+{
+	elr_mpl_t      alloc_mpl = ELR_MPL_INITIALIZER;
+	elr_mem_pool  *alloc_pool = NULL;
+
+	assert(hpool == NULL || elr_mpl_avail(hpool) != 0);
+
+	if (hpool == NULL)
+		hpool = &g_multi_mem_pool;
+
+	alloc_pool = _elr_multi_pool_of((elr_mem_pool*)hpool->pool, size);
+	if (alloc_pool == NULL)
+		return NULL;
+
+	if (alloc_pool->large == 1)
+	{
+		void *mem = NULL;
+#ifdef ELR_USE_HISTOGRAM
+		unsigned long long start = _elr_now();
+		mem = _elr_large_alloc(alloc_pool, size, 1);
+		_elr_latency_add(alloc_pool, ELR_MPL_LATENCY_ALLOC, _elr_now() - start);
+#else
+		mem = _elr_large_alloc(alloc_pool, size, 1);
+#endif // ELR_USE_HISTOGRAM
+#ifdef ELR_USE_SAMPLING
+		if (g_sample_rate != 0 && mem != NULL)
+			_elr_sample_alloc(alloc_pool, mem, size);
+#endif // ELR_USE_SAMPLING
+		return mem;
+	}
+
+	alloc_mpl.pool = alloc_pool;
+	alloc_mpl.tag = alloc_pool->slice_tag;
+#ifdef ELR_USE_HISTOGRAM
+	_elr_request_add(alloc_pool, size);
+#endif // ELR_USE_HISTOGRAM
+	return elr_mpl_calloc(&alloc_mpl);
+}
+
+/*
+** ıӶߴڴڴĴС
+** ڴڵڴµĴСʱԭطأڶߴڴ벢ơ
+** linuxϴڴͨmremapӳ䣬ݡ
+** ڴСڴֵʱƵӦߴڴأ
+** ǴڴʱlinuxСӳ䣬ϵͳСһʱ롣
+*/
+ELR_MPL_API void * elr_mpl_realloc_multi(elr_mpl_ht hpool, void* mem, size_t size)
+{
+	size_t         old_size = 0;
+	void          *new_mem = NULL;
+	elr_mem_slice *slice = NULL;
+	elr_mem_pool  *pool = NULL;
+
+	assert(hpool == NULL || elr_mpl_avail(hpool) != 0);
+
+	if (mem == NULL)
+		return elr_mpl_alloc_multi(hpool, size);
+	if (size == 0)
+	{
+		elr_mpl_free(mem);
+		return NULL;
+	}
+
+	old_size = elr_mpl_size(mem);
+	if (_elr_compact_node_of(mem) == NULL)
+	{
+		slice = (elr_mem_slice*)((char*)mem
+			- ELR_ALIGN(sizeof(elr_mem_slice), sizeof(int)));
+		pool = slice->node->owner;
+	}
+
+	if (size <= old_size)
+	{
+		if (pool == NULL || pool->large == 0)
+			return mem;
+		/*ڴڴصķ䵥ԪСǴڴֵ*/
+		if (size >= pool->object_size)
+		{
+#if defined(__linux__)
+			/*Сӳ䲻ƶڴ飬ҳϵͳ*/
+			if (old_size - size >= g_page_size
+				&& (new_mem = _elr_large_remap(pool, slice, size)) != NULL)
+			{
+#ifdef ELR_USE_SAMPLING
+				if (slice->sampled != 0)
+					_elr_sample_move(mem, new_mem, size);
+#endif // ELR_USE_SAMPLING
+				return new_mem;
+			}
+			return mem;
+#else
+			if (size > old_size / 2)
+				return mem;
+#endif
+		}
+		/*СʱʧԿԼʹԭڴ*/
+		if ((new_mem = elr_mpl_alloc_multi(hpool, size)) == NULL)
+			return mem;
+		memcpy(new_mem, mem, size);
+		elr_mpl_free(mem);
+		return new_mem;
+	}
+
+#if defined(__linux__)
+	if (pool != NULL && pool->large == 1 && pool->align <= g_page_size
+		&& (new_mem = _elr_large_remap(pool, slice, size)) != NULL)
+	{
+#ifdef ELR_USE_SAMPLING
+		/*ƬͷӳƶȻЧ*/
+		slice = (elr_mem_slice*)((char*)new_mem
+			- ELR_ALIGN(sizeof(elr_mem_slice), sizeof(int)));
+		if (slice->sampled != 0)
+			_elr_sample_move(mem, new_mem, size);
+#endif // ELR_USE_SAMPLING
+		return new_mem;
+	}
+#endif
+
+	if ((new_mem = elr_mpl_alloc_multi(hpool, size)) == NULL)
+		return NULL;
+	memcpy(new_mem, mem, old_size);
+	elr_mpl_free(mem);
+	return new_mem;
+}
+
+/*
+** ڶߴڴвsizeֽڵڴأ
+** ڴʱΧڴػڴڴء
+** ¼ߴֱͼʱҲ¼
+*/
+elr_mem_pool* _elr_multi_pool_of(elr_mem_pool* pool, size_t size)
+{
+	elr_mem_pool  *alloc_pool = NULL;
+	int i = 0;
+
+	assert(pool->multi != NULL);
+
+	if (pool->profiling == 1)
+		_elr_profile_add(pool, size);
+
+	/*ߴٸı䣬ҲҪ*/
+	i = _elr_class_of(pool, size);
+	if (i < pool->multi_count)
+	{
+		alloc_pool = pool->multi[i];
+	}
+	else
+	{
+#ifdef ELR_USE_THREAD
+		if (pool->sync == 1)
+			_elr_mpl_lock(pool);
+#endif // ELR_USE_THREAD
+		if (pool->large_size > 0 && size >= pool->large_size)
+		{
+			if (pool->large_pool == NULL)
+			{
+				alloc_pool = _elr_mpl_create(pool->multi[pool->multi_count - 1],
+					pool->large_size, pool->multi[pool->multi_count - 1]->align,
+					pool->on_slice_alloc, pool->on_slice_free,
+#ifdef ELR_USE_THREAD
+					pool->sync);
+#else
+					0);
+#endif // ELR_USE_THREAD
+				if (alloc_pool != NULL)
+				{
+					alloc_pool->track = pool->multi[pool->multi_count - 1]->track;
+					alloc_pool->large = 1;
+					alloc_pool->node_size = 0;
+					pool->large_pool = alloc_pool;
+				}
+			}
+			alloc_pool = pool->large_pool;
+		}
+		else
+		{
+			alloc_pool = _elr_overrange_pool(pool, size);
+		}
+#ifdef ELR_USE_THREAD
+		if (pool->sync == 1)
+			elr_mtx_unlock(&pool->pool_mutex);
+#endif // ELR_USE_THREAD
+	}
+
+	return alloc_pool;
+}
+
+/*
+** öߴڴصĴڴֵ
+*/
+ELR_MPL_API void elr_mpl_set_large_size(elr_mpl_ht hpool, size_t size)
+{
+	elr_mem_pool  *pool = NULL;
+
+	assert(hpool == NULL || elr_mpl_avail(hpool) != 0);
+
+	if (hpool == NULL)
+		hpool = &g_multi_mem_pool;
+	pool = (elr_mem_pool*)hpool->pool;
+
+	assert(pool->multi != NULL);
+
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		_elr_mpl_lock(pool);
+#endif // ELR_USE_THREAD
+	pool->large_size = size;
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		elr_mtx_unlock(&pool->pool_mutex);
+#endif // ELR_USE_THREAD
+}
+
+/*
+** Ӵڴڴڴ顣
+** ÿڴռһΰҳڴӳ䣬ӳĿͷǽڵͷƬͷ
+** ڵfirst_availָӳĩβɴ˿Եõӳ䳤ȺڴĿôС
+** ȸûҲСӳ䡣
+*/
+void* _elr_large_alloc(elr_mem_pool* pool, size_t size, int zero)
+{
+	size_t         head = _elr_node_head(pool) + ELR_ALIGN(sizeof(elr_mem_slice), sizeof(int));
+	size_t         length = ELR_ALIGN(head + size, g_page_size);
+	size_t         mapped = 0;
+	elr_mem_node  *node = NULL;
+	elr_mem_node  *prev = NULL;
+	elr_mem_node  *best = NULL;
+	elr_mem_node  *best_prev = NULL;
+	elr_mem_slice *slice = NULL;
+	char          *mem = NULL;
+
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		_elr_mpl_lock(pool);
+#endif // ELR_USE_THREAD
+	for (node = pool->large_cache; node != NULL; prev = node, node = node->next)
+	{
+		mapped = node->first_avail - (char*)node;
+		if (mapped >= length && mapped / 2 <= length
+			&& (best == NULL || mapped < (size_t)(best->first_avail - (char*)best)))
+		{
+			best = node;
+			best_prev = prev;
+		}
+	}
+	if ((node = best) != NULL)
+	{
+		if (best_prev != NULL)
+			best_prev->next = node->next;
+		else
+			pool->large_cache = node->next;
+		pool->large_cache_count--;
+	}
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		elr_mtx_unlock(&pool->pool_mutex);
+#endif // ELR_USE_THREAD
+
+	if (node == NULL)
+	{
+#ifdef ELR_USE_HISTOGRAM
+		unsigned long long start = _elr_now();
+		node = (elr_mem_node*)_elr_map(length);
+		_elr_latency_add(pool, ELR_MPL_LATENCY_REFILL, _elr_now() - start);
+#else
+		node = (elr_mem_node*)_elr_map(length);
+#endif // ELR_USE_HISTOGRAM
+		if (node == NULL)
+			return NULL;
+		node->owner = pool;
+		node->first_avail = (char*)node + length;
+		node->free_slice_head = NULL;
+		node->free_slice_tail = NULL;
+		node->used_slice_count = 0;
+		slice = (elr_mem_slice*)((char*)node + _elr_node_head(pool));
+		slice->node = node;
+		slice->tag = 0;
+#ifdef ELR_USE_SAMPLING
+		slice->sampled = 0;
+#endif // ELR_USE_SAMPLING
+		g_occupation_size += length;
+	}
+	slice = (elr_mem_slice*)((char*)node + _elr_node_head(pool));
+	slice->tag++;
+	node->used_slice_count++;
+	node->using_slice_count = 1;
+	mem = (char*)node + head;
+
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		_elr_mpl_lock(pool);
+#endif // ELR_USE_THREAD
+	node->prev = NULL;
+	node->next = pool->first_node;
+	if (pool->first_node != NULL)
+		pool->first_node->prev = node;
+	pool->first_node = node;
+	if (pool->track == 1)
+	{
+		slice->prev = NULL;
+		slice->next = pool->first_occupied_slice;
+		if (pool->first_occupied_slice != NULL)
+			pool->first_occupied_slice->prev = slice;
+		pool->first_occupied_slice = slice;
+	}
+	pool->alloc_count++;
+	/*ǩΪ1˵ӳڴ*/
+	if (slice->tag == 1)
+		pool->node_alloc_count++;
+	_elr_live_add(pool, 1);
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		elr_mtx_unlock(&pool->pool_mutex);
+#endif // ELR_USE_THREAD
+
+	/*ӳڴ汾*/
+	if (zero != 0 && slice->tag != 1)
+		_elr_zero(mem, size);
+	if (pool->on_slice_alloc != NULL)
+		pool->on_slice_alloc(mem);
+
+	return mem;
+}
+
+/*
+** ڴ黹ڴڴء
+** ڴڵҳͨmadviseϵͳ뻺棬ʱӳ䡣
+*/
+void _elr_large_free(elr_mem_pool* pool, elr_mem_slice* slice)
+{
+	elr_mem_node  *node = slice->node;
+	elr_mem_node  *evict = NULL;
+	char          *mem = (char*)slice + ELR_ALIGN(sizeof(elr_mem_slice), sizeof(int));
+	char          *first_page = (char*)ELR_ALIGN((size_t)mem, g_page_size);
+
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		_elr_mpl_lock(pool);
+#endif // ELR_USE_THREAD
+	slice->tag++;
+	if (pool->on_slice_free != NULL)
+		pool->on_slice_free(mem);
+	_elr_slice_unlink(pool, slice);
+	node->using_slice_count = 0;
+	pool->live_slice_count--;
+	pool->free_count++;
+	if (node->next != NULL)
+		node->next->prev = node->prev;
+	if (node->prev != NULL)
+		node->prev->next = node->next;
+	else
+		pool->first_node = node->next;
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		elr_mtx_unlock(&pool->pool_mutex);
+#endif // ELR_USE_THREAD
+
+	/*ڵͷڵҳҳϵͳӳ䱾*/
+	if (first_page < node->first_avail)
+	{
+#if defined(_WIN32)
+		VirtualAlloc(first_page, node->first_avail - first_page, MEM_RESET, PAGE_READWRITE);
+#else
+		madvise(first_page, node->first_avail - first_page, MADV_DONTNEED);
+#endif
+	}
+
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		_elr_mpl_lock(pool);
+#endif // ELR_USE_THREAD
+	node->next = pool->large_cache;
+	pool->large_cache = node;
+	if (pool->large_cache_count == ELR_LARGE_CACHE_COUNT)
+	{
+		/*βӳ*/
+		for (evict = node; evict->next->next != NULL; evict = evict->next);
+		node = evict->next;
+		evict->next = NULL;
+	}
+	else
+	{
+		pool->large_cache_count++;
+		node = NULL;
+	}
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		elr_mtx_unlock(&pool->pool_mutex);
+#endif // ELR_USE_THREAD
+
+	if (node != NULL)
+		_elr_node_free(pool, node);
+}
+
+#if defined(__linux__)
+/*
+** mremapڴӳsizeֽڣµڴַʧʱNULL
+** ӳԭʱϵͳƶҳݡ
+** ӳڼڵƬժ£֮߳̿½롣
+*/
+void* _elr_large_remap(elr_mem_pool* pool, elr_mem_slice* slice, size_t size)
+{
+	size_t         head = _elr_node_head(pool) + ELR_ALIGN(sizeof(elr_mem_slice), sizeof(int));
+	size_t         length = ELR_ALIGN(head + size, g_page_size);
+	elr_mem_node  *node = slice->node;
+	size_t         mapped = node->first_avail - (char*)node;
+	void          *addr = NULL;
+
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		_elr_mpl_lock(pool);
+#endif // ELR_USE_THREAD
+	_elr_slice_unlink(pool, slice);
+	if (node->next != NULL)
+		node->next->prev = node->prev;
+	if (node->prev != NULL)
+		node->prev->next = node->next;
+	else
+		pool->first_node = node->next;
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		elr_mtx_unlock(&pool->pool_mutex);
+#endif // ELR_USE_THREAD
+
+	addr = mremap(node, mapped, length, MREMAP_MAYMOVE);
+	if (addr != MAP_FAILED)
+	{
+		node = (elr_mem_node*)addr;
+		node->first_avail = (char*)node + length;
+		slice = (elr_mem_slice*)((char*)node + _elr_node_head(pool));
+		slice->node = node;
+	}
+
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		_elr_mpl_lock(pool);
+#endif // ELR_USE_THREAD
+	if (addr != MAP_FAILED)
+		g_occupation_size += length - mapped;
+	node->prev = NULL;
+	node->next = pool->first_node;
+	if (pool->first_node != NULL)
+		pool->first_node->prev = node;
+	pool->first_node = node;
+	if (pool->track == 1)
+	{
+		slice->prev = NULL;
+		slice->next = pool->first_occupied_slice;
+		if (pool->first_occupied_slice != NULL)
+			pool->first_occupied_slice->prev = slice;
+		pool->first_occupied_slice = slice;
+	}
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		elr_mtx_unlock(&pool->pool_mutex);
+#endif // ELR_USE_THREAD
+
+	return addr == MAP_FAILED ? NULL : (char*)node + head;
+}
+#endif
+
+/*
+** lengthֽڵڴӳ䣬lengthҳСʧܷNULL
+*/
+void* _elr_map(size_t length)
+{
+#if defined(_WIN32)
+	return VirtualAlloc(NULL, length, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+	void* addr = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	return addr == MAP_FAILED ? NULL : addr;
+#endif
+}
+
+/*
+** ͷ_elr_mapڴӳ䡣
+*/
+void _elr_unmap(void* addr, size_t length)
+{
+#if defined(_WIN32)
+	VirtualFree(addr, 0, MEM_RELEASE);
+#else
+	munmap(addr, length);
+#endif
+}
+
+/*
+** lengthֽڰҳڴӳ䣬lengthǴҳС
+** linuxȳMAP_HUGETLBʧܺӳһҳٽȡĲ֣
+** madviseں͸ҳأϵͳ֧ʱͨڴӳ䡣
+** windowsȳMEM_LARGE_PAGESûڴҳȨʱʧܡ
+*/
+void* _elr_map_huge(size_t length)
+{
+#if defined(_WIN32)
+	void*  addr = NULL;
+
+	if (g_hugetlb_failed == 0 && GetLargePageMinimum() > 0
+		&& length % GetLargePageMinimum() == 0)
+	{
+		addr = VirtualAlloc(NULL, length,
+			MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+		if (addr != NULL)
+			return addr;
+		g_hugetlb_failed = 1;
+	}
+	return VirtualAlloc(NULL, length, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+	char*  addr = NULL;
+	char*  aligned = NULL;
+
+#if defined(MAP_HUGETLB)
+	if (g_hugetlb_failed == 0)
+	{
+		addr = (char*)mmap(NULL, length, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (addr != (char*)MAP_FAILED)
+			return addr;
+		g_hugetlb_failed = 1;
+	}
+#endif
+	addr = (char*)mmap(NULL, length + ELR_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (addr == (char*)MAP_FAILED)
+		return NULL;
+
+	aligned = (char*)ELR_ALIGN((size_t)addr, ELR_HUGE_PAGE_SIZE);
+	if (aligned > addr)
+		munmap(addr, aligned - addr);
+	if (addr + ELR_HUGE_PAGE_SIZE > aligned)
+		munmap(aligned + length, addr + ELR_HUGE_PAGE_SIZE - aligned);
+#if defined(MADV_HUGEPAGE)
+	madvise(aligned, length, MADV_HUGEPAGE);
+#endif
+	return aligned;
+#endif
+}
+
+/*
+** ڴصڴڵǷʹôҳ
+*/
+ELR_MPL_API int elr_mpl_set_huge_page(elr_mpl_ht hpool, int enable)
+{
+	elr_mem_pool  *pool = NULL;
+	int            ret = 1;
+	int            j = 0;
+
+	assert(hpool != NULL && elr_mpl_avail(hpool) != 0);
+	pool = (elr_mem_pool*)hpool->pool;
+
+	if (pool->shards != NULL)
+	{
+		for (j = 0; j < pool->shard_count; j++)
+		{
+			if (_elr_mpl_set_huge(pool->shards[j], enable) == 0)
+				ret = 0;
+		}
+		return ret;
+	}
+
+	if (pool->multi == NULL)
+		return _elr_mpl_set_huge(pool, enable);
+
+	for (j = 0; j < pool->multi_count; j++)
+	{
+		if (_elr_mpl_set_huge(pool->multi[j], enable) == 0)
+			ret = 0;
+	}
+	return ret;
+}
+
+/*
+** ڴǷʹôҳ¼ڴڵĴС
+** ʹôҳʱڴڵǡռҳоڴƬ
+** ڴصĽڵС̶ʹôҳ
+*/
+int _elr_mpl_set_huge(elr_mem_pool* pool, int enable)
+{
+	int     ret = 0;
+	size_t  head = 0;
+
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		_elr_mpl_lock(pool);
+#endif // ELR_USE_THREAD
+	if (pool->first_node == NULL && pool->compact == 0 && pool->large == 0
+		&& pool->arena == 0)
+	{
+		ret = 1;
+		pool->huge = enable != 0 ? 1 : 0;
+		head = _elr_node_head(pool);
+		if (pool->huge == 1)
+		{
+			pool->node_size = ELR_ALIGN(head + pool->slice_size, ELR_HUGE_PAGE_SIZE);
+			pool->slice_count = (pool->node_size - head) / pool->slice_size;
+		}
+		else
+		{
+			if (pool->slice_size < ELR_MAX_SLICE_SIZE)
+				pool->slice_count = ELR_MAX_SLICE_COUNT
+				- pool->slice_size*(ELR_MAX_SLICE_COUNT - 1) / ELR_MAX_SLICE_SIZE;
+			else
+				pool->slice_count = 1;
+			pool->node_size = pool->slice_size*pool->slice_count + head;
+		}
+	}
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		elr_mtx_unlock(&pool->pool_mutex);
+#endif // ELR_USE_THREAD
+
+	return ret;
+}
+
+/*
+** ڴǷάõڴƬ
+** ߴڴеĳΧڴغʹڴڴҲһã֮󴴽ĸһڴء
+*/
+ELR_MPL_API int elr_mpl_set_tracking(elr_mpl_ht hpool, int enable)
+{
+	elr_mem_pool  *pool = NULL;
+	int            ret = 1;
+	int            j = 0;
+	size_t         i = 0;
+
+	assert(hpool != NULL && elr_mpl_avail(hpool) != 0);
+	pool = (elr_mem_pool*)hpool->pool;
+
+	if (pool->shards != NULL)
+	{
+		for (j = 0; j < pool->shard_count; j++)
+		{
+			if (_elr_mpl_set_tracking(pool->shards[j], enable) == 0)
+				ret = 0;
+		}
+		return ret;
+	}
+
+	if (pool->multi == NULL)
+		return _elr_mpl_set_tracking(pool, enable);
+
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		_elr_mpl_lock(pool);
+#endif // ELR_USE_THREAD
+	for (j = 0; j < pool->multi_count; j++)
+	{
+		if (_elr_mpl_set_tracking(pool->multi[j], enable) == 0)
+			ret = 0;
+	}
+	if (pool->large_pool != NULL && _elr_mpl_set_tracking(pool->large_pool, enable) == 0)
+		ret = 0;
+	for (i = 0; i < pool->overrange_capacity; i++)
+	{
+		if (pool->overrange[i] != NULL
+			&& _elr_mpl_set_tracking(pool->overrange[i], enable) == 0)
+			ret = 0;
+	}
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		elr_mtx_unlock(&pool->pool_mutex);
+#endif // ELR_USE_THREAD
+	return ret;
+}
+
+/*
+** ڴǷάõڴƬڴڴʱá
+** ڴءĳ̵߳ڴءڴغ;ڴشӲά
+*/
+int _elr_mpl_set_tracking(elr_mem_pool* pool, int enable)
+{
+	int     ret = 0;
+
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		_elr_mpl_lock(pool);
+	if (pool->live_slice_count == 0 && pool->compact == 0 && pool->arena == 0
+		&& pool->lockfree == 0 && pool->owner_thread == 0)
+#else
+	if (pool->live_slice_count == 0 && pool->compact == 0 && pool->arena == 0)
+#endif // ELR_USE_THREAD
+	{
+		ret = 1;
+		pool->track = enable != 0 ? 1 : 0;
+	}
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		elr_mtx_unlock(&pool->pool_mutex);
+#endif // ELR_USE_THREAD
+
+	return ret;
+}
+
+/*
+** ڴرڴڵĲԡ
+*/
+ELR_MPL_API void elr_mpl_set_retention(elr_mpl_ht hpool, size_t low, size_t high)
+{
+	elr_mem_pool  *pool = NULL;
+	elr_mem_pool  *child = NULL;
+	elr_mem_pool **members = NULL;
+	int            count = 1;
+	int            j = 0;
+
+	assert(hpool != NULL && elr_mpl_avail(hpool) != 0);
+	pool = (elr_mem_pool*)hpool->pool;
+
+	if (high < low)
+		high = low;
+
+	/*ߴڴеڴأƬڴзƬ*/
+	if (pool->multi != NULL)
+	{
+		members = pool->multi;
+		count = pool->multi_count;
+	}
+	else if (pool->shards != NULL)
+	{
+		members = pool->shards;
+		count = pool->shard_count;
+	}
+
+	for (j = 0; j < count; j++)
+	{
+		child = members == NULL ? pool : members[j];
+#ifdef ELR_USE_THREAD
+		if (child->sync == 1)
+			elr_mtx_lock(&child->pool_mutex);
+#endif // ELR_USE_THREAD
+		child->retain = 1;
+		child->retain_low = low;
+		child->retain_high = high;
+		if (child->empty_node_count > high)
+			_elr_mpl_release_empty(child, low);
+#ifdef ELR_USE_THREAD
+		if (child->sync == 1)
+			elr_mtx_unlock(&child->pool_mutex);
+#endif // ELR_USE_THREAD
+	}
+}
+
+/*
+** ͷڴصĿڴڵ㡣
+** ߴڴصڴضᱻΧڴغʹڴڴҲڡ
+*/
+ELR_MPL_API size_t elr_mpl_trim(elr_mpl_ht hpool, int recursive)
+{
+	elr_mem_pool  *pool = NULL;
+	size_t         released = 0;
+	int            j = 0;
+
+	assert(hpool != NULL && elr_mpl_avail(hpool) != 0);
+	pool = (elr_mem_pool*)hpool->pool;
+
+	/*ƬڴǰƬ*/
+	if (pool->shards != NULL && recursive == 0)
+	{
+		for (j = 0; j < pool->shard_count; j++)
+			released += _elr_mpl_trim(pool->shards[j], 0);
+		return released;
+	}
+
+	if (pool->multi == NULL)
+		return _elr_mpl_trim(pool, recursive);
+
+	for (j = 0; j < pool->multi_count; j++)
+		released += _elr_mpl_trim(pool->multi[j], recursive || j == pool->multi_count - 1);
+	return released;
+}
+
+/*
+** ͷڴصпڴڵͻڴӳ䣬recursiveΪ0ʱҲڴء
+** ڴڵǰڴص
+*/
+size_t _elr_mpl_trim(elr_mem_pool* pool, int recursive)
+{
+	size_t         released = 0;
+	elr_mem_node  *node = NULL;
+	elr_mem_pool  *child = NULL;
+
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		_elr_mpl_lock(pool);
+	/*ӵȡ߳ͷŵƬЩƬڵڴڵ㲻*/
+	if (pool->owner_thread != 0 && pool->owner_thread == elr_thread_self())
+		_elr_remote_drain(pool);
+	/*߳ӵеڴصڴڵ㲻ر仯ֻӵ*/
+	if (pool->owner_thread == 0 || pool->owner_thread == elr_thread_self())
+#endif // ELR_USE_THREAD
+	released += _elr_mpl_release_empty(pool, 0);
+	while ((node = pool->large_cache) != NULL)
+	{
+		pool->large_cache = node->next;
+		released += node->first_avail - (char*)node;
+		_elr_node_free(pool, node);
+	}
+	pool->large_cache_count = 0;
+
+	if (recursive != 0)
+	{
+		for (child = pool->first_child; child != NULL; child = child->next)
+			released += _elr_mpl_trim(child, 1);
+	}
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		elr_mtx_unlock(&pool->pool_mutex);
+#endif // ELR_USE_THREAD
+
+	return released;
+}
+
+/*
+** ȡڴصͳݡ
+*/
+ELR_MPL_API void elr_mpl_stats(elr_mpl_ht hpool, elr_mpl_stats_t* stats, int recursive)
+{
+	elr_mem_pool  *pool = NULL;
+	int            j = 0;
+
+	assert(hpool == NULL || elr_mpl_avail(hpool) != 0);
+	assert(stats != NULL);
+
+	memset(stats, 0, sizeof(elr_mpl_stats_t));
+#ifdef ELR_USE_THREAD
+	elr_mtx_lock(&g_tree_mutex);
+#endif // ELR_USE_THREAD
+	if (hpool == NULL)
+	{
+		_elr_mpl_stats(&g_mem_pool, stats, 1);
+	}
+	else
+	{
+		pool = (elr_mem_pool*)hpool->pool;
+		/*ƬڴǰƬ*/
+		if (pool->shards != NULL && recursive == 0)
+		{
+			_elr_mpl_stats(pool, stats, 0);
+			for (j = 0; j < pool->shard_count; j++)
+				_elr_mpl_stats(pool->shards[j], stats, 0);
+		}
+		else if (pool->multi == NULL)
+		{
+			_elr_mpl_stats(pool, stats, recursive);
+		}
+		else
+		{
+			for (j = 0; j < pool->multi_count; j++)
+				_elr_mpl_stats(pool->multi[j], stats, recursive || j == pool->multi_count - 1);
+		}
+	}
+#ifdef ELR_USE_THREAD
+	elr_mtx_unlock(&g_tree_mutex);
+#endif // ELR_USE_THREAD
+}
+
+/*
+** ڴصͳۼӵstatsУrecursiveΪ0ʱҲۼڴصġ
+** ڴʱڴȫڴأ
+** ڴڵǰڴصͳƣκʱֻһڴص
+*/
+void _elr_mpl_stats(elr_mem_pool* pool, elr_mpl_stats_t* stats, int recursive)
+{
+	elr_mem_node  *node = NULL;
+	elr_mem_pool  *child = NULL;
+	size_t         node_count = 0;
+	size_t         live = 0;
+
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		_elr_mpl_lock(pool);
+	/*ӵȡ߳ͷŵƬЩƬټΪ*/
+	if (pool->owner_thread != 0 && pool->owner_thread == elr_thread_self())
+		_elr_remote_drain(pool);
+#endif // ELR_USE_THREAD
+	live = pool->live_slice_count;
+	stats->alloc_count += pool->alloc_count;
+	stats->free_count += pool->free_count;
+#ifdef ELR_USE_THREAD
+	/*ڴصƬͷŴólive_slice_countǻֹƬ*/
+	if (pool->lockfree == 1)
+	{
+		elr_counter64_t allocs = elr_atomic_load64(&pool->lockfree_allocs);
+		elr_counter64_t frees = elr_atomic_load64(&pool->lockfree_frees);
+		stats->alloc_count += (size_t)allocs;
+		stats->free_count += (size_t)frees;
+		live = allocs > frees ? (size_t)(allocs - frees) : 0;
+	}
+#endif // ELR_USE_THREAD
+
+	stats->pool_count++;
+	stats->slice_count += live;
+	stats->peak_slice_count += pool->peak_slice_count;
+	stats->node_alloc_count += pool->node_alloc_count;
+
+	node = pool->first_node;
+#ifdef ELR_USE_THREAD
+	/*߳ӵеڴصڴڵ㲻ر仯ͳ*/
+	if (pool->owner_thread != 0 && pool->owner_thread != elr_thread_self())
+		node = NULL;
+#endif // ELR_USE_THREAD
+	for (; node != NULL; node = node->next)
+	{
+		node_count++;
+		if (pool->large == 1)
+		{
+			stats->reserved_size += node->first_avail - (char*)node;
+			stats->requested_size += node->first_avail - ((char*)node
+				+ _elr_node_head(pool) + ELR_ALIGN(sizeof(elr_mem_slice), sizeof(int)));
+		}
+		else if (pool->arena == 1)
+		{
+			stats->reserved_size += node->used_slice_count;
+			stats->requested_size += node->first_avail - ((char*)node + ELR_ARENA_NODE_HEAD);
+		}
+	}
+
+	if (pool->large == 1)
+	{
+		for (node = pool->large_cache; node != NULL; node = node->next)
+		{
+			stats->reserved_size += node->first_avail - (char*)node;
+			stats->free_slice_count++;
+		}
+		stats->node_count += node_count + pool->large_cache_count;
+	}
+	else if (pool->arena == 1)
+	{
+		stats->node_count += node_count;
+	}
+	else
+	{
+		stats->node_count += node_count;
+		stats->reserved_size += node_count * pool->node_size;
+		stats->requested_size += live * pool->object_size;
+		if (node_count * pool->slice_count > live)
+			stats->free_slice_count += node_count * pool->slice_count - live;
+	}
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		elr_mtx_unlock(&pool->pool_mutex);
+#endif // ELR_USE_THREAD
+
+	if (recursive != 0)
+	{
+		for (child = _elr_first_child(pool); child != NULL; child = child->next)
+			_elr_mpl_stats(child, stats, 1);
+	}
+}
+
+/*
+** ڴصȡõһڴء
+** ڴǲ뵽ͷֻڴʱŻƳ
+** ߳g_tree_mutexʱȡõڴؿʼٸı䡣
+*/
+elr_mem_pool* _elr_first_child(elr_mem_pool* pool)
+{
+	elr_mem_pool  *child = NULL;
+
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		elr_mtx_lock(&pool->pool_mutex);
+#endif // ELR_USE_THREAD
+	child = pool->first_child;
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		elr_mtx_unlock(&pool->pool_mutex);
+#endif // ELR_USE_THREAD
+
+	return child;
+}
+
+/*
+** ɰμĳߴڳߴ֮ʹڲƬmax_waste
+** ߴ簴ָС룬min_sizeʼһߴ粻Сmax_size
+** سߴдcapacity
+*/
+ELR_MPL_API int elr_mpl_geometric_classes(size_t min_size,
+	size_t max_size,
+	double max_waste,
+	size_t* obj_size,
+	int capacity)
+{
+	size_t size = ELR_ALIGN(min_size == 0 ? 1 : min_size, sizeof(void*));
+	size_t next = 0;
+	int    count = 0;
+
+	assert(max_waste > 0 && max_waste < 1);
+	assert(obj_size != NULL || capacity == 0);
+
+	for (;;)
+	{
+		if (count < capacity)
+			obj_size[count] = size;
+		count++;
+		if (size >= max_size)
+			break;
+
+		/*size+1ֽʱõnextֽڣ˷ѵımax_waste*/
+		next = (size_t)((double)size / (1 - max_waste)) & ~(sizeof(void*) - 1);
+		if (next < size + sizeof(void*))
+			next = size + sizeof(void*);
+		if (next > max_size)
+			next = ELR_ALIGN(max_size, sizeof(void*));
+		size = next;
+	}
+
+	return count;
+}
+
+/*
+** ʼֹͣ¼ߴڴصߴֱͼ
+** ֱͼڵһοʼ¼ʱ룬ֹͣ¼ֱڴ١
+*/
+ELR_MPL_API int elr_mpl_set_profiling(elr_mpl_ht hpool, int enable)
+{
+	elr_mem_pool  *pool = NULL;
+	int            ret = 1;
+
+	assert(hpool == NULL || elr_mpl_avail(hpool) != 0);
+
+	if (hpool == NULL)
+		hpool = &g_multi_mem_pool;
+	pool = (elr_mem_pool*)hpool->pool;
+	assert(pool->multi != NULL);
+
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		_elr_mpl_lock(pool);
+#endif // ELR_USE_THREAD
+	if (enable != 0 && pool->size_profile == NULL)
+		pool->size_profile = (elr_stat_counter64*)calloc(ELR_PROFILE_BUCKETS + 1,
+			sizeof(elr_stat_counter64));
+	if (enable != 0 && pool->size_profile == NULL)
+		ret = 0;
+	else
+		pool->profiling = enable != 0 ? 1 : 0;
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		elr_mtx_unlock(&pool->pool_mutex);
+#endif // ELR_USE_THREAD
+
+	return ret;
+}
+
+/*
+** ߴڴصߴֱͼ
+*/
+ELR_MPL_API void elr_mpl_profile_reset(elr_mpl_ht hpool)
+{
+	elr_mem_pool  *pool = NULL;
+	size_t         k = 0;
+
+	assert(hpool == NULL || elr_mpl_avail(hpool) != 0);
+
+	if (hpool == NULL)
+		hpool = &g_multi_mem_pool;
+	pool = (elr_mem_pool*)hpool->pool;
+
+	if (pool->size_profile == NULL)
+		return;
+	for (k = 0; k <= ELR_PROFILE_BUCKETS; k++)
+		pool->size_profile[k] = 0;
+}
+
+/*
+** ߴֱͼ㲻max_countߴĳߴʹռõֽ١
+** ߴֻȡֱͼгֹͰϽ磬iͰϽΪv[i]ǰ׺Ϊc[i]
+** ǰjߴ縲ǰiͰߴΪv[i]СֽΪ
+** f[j][i] = min(f[j-1][p] + v[i] * (c[i] - c[p]))p < i
+** سߴĸûм¼ʱ0
+*/
+ELR_MPL_API int elr_mpl_suggest_classes(elr_mpl_ht hpool, int max_count, size_t* obj_size)
+{
+	elr_mem_pool  *pool = NULL;
+	size_t        *value = NULL;
+	double        *count = NULL;
+	double        *prev = NULL;
+	double        *cur = NULL;
+	double        *swap = NULL;
+	int           *from = NULL;
+	double         cost = 0;
+	size_t         k = 0;
+	int            m = 0;
+	int            n = 0;
+	int            i = 0;
+	int            j = 0;
+	int            p = 0;
+
+	assert(hpool == NULL || elr_mpl_avail(hpool) != 0);
+	assert(max_count > 0 && obj_size != NULL);
+
+	if (hpool == NULL)
+		hpool = &g_multi_mem_pool;
+	pool = (elr_mem_pool*)hpool->pool;
+	if (pool->size_profile == NULL)
+		return 0;
+
+	/*ȡֹͰvalue[i]ͰϽ磬count[i+1]ǰi+1Ͱ֮*/
+	value = (size_t*)malloc(ELR_PROFILE_BUCKETS * sizeof(size_t));
+	count = (double*)malloc((ELR_PROFILE_BUCKETS + 1) * sizeof(double));
+	if (value == NULL || count == NULL)
+		goto out;
+	count[0] = 0;
+	for (k = 0; k < ELR_PROFILE_BUCKETS; k++)
+	{
+#ifdef ELR_USE_THREAD
+		cost = (double)elr_atomic_load64(&pool->size_profile[k]);
+#else
+		cost = (double)pool->size_profile[k];
+#endif // ELR_USE_THREAD
+		if (cost > 0)
+		{
+			value[m] = (k + 1) * ELR_PROFILE_UNIT;
+			count[m + 1] = count[m] + cost;
+			m++;
+		}
+	}
+	if (m == 0)
+		goto out;
+	if (max_count > m)
+		max_count = m;
+
+	/*from[j*m+i]f[j][i]ȡСֵʱǰһߴڵͰ-1ʾûиСĳߴ磬-2ʾһߴʱ*/
+	prev = (double*)malloc(m * sizeof(double));
+	cur = (double*)malloc(m * sizeof(double));
+	from = (int*)malloc((size_t)max_count * m * sizeof(int));
+	if (prev == NULL || cur == NULL || from == NULL)
+		goto out;
+
+	for (i = 0; i < m; i++)
+	{
+		prev[i] = (double)value[i] * count[i + 1];
+		from[i] = -1;
+	}
+	for (j = 1; j < max_count; j++)
+	{
+		for (i = 0; i < m; i++)
+		{
+			cur[i] = prev[i];
+			from[j * m + i] = -2;
+			for (p = 0; p < i; p++)
+			{
+				cost = prev[p] + (double)value[i] * (count[i + 1] - count[p + 1]);
+				if (cost < cur[i])
+				{
+					cur[i] = cost;
+					from[j * m + i] = p;
+				}
+			}
+		}
+		swap = prev;
+		prev = cur;
+		cur = swap;
+	}
+
+	/*ĳߴһͰfromߴ磬õĳߴӴС*/
+	for (j = max_count - 1, i = m - 1; i >= 0; j--)
+	{
+		if (from[j * m + i] == -2)
+			continue;
+		obj_size[n++] = value[i];
+		i = from[j * m + i];
+	}
+	for (i = 0; i < n / 2; i++)
+	{
+		k = obj_size[i];
+		obj_size[i] = obj_size[n - 1 - i];
+		obj_size[n - 1 - i] = k;
+	}
+
+out:
+	free(value);
+	free(count);
+	free(prev);
+	free(cur);
+	free(from);
+	return n;
+}
+
+/*
+** ߴ浽ıļУÿһߴ硣
+*/
+ELR_MPL_API int elr_mpl_save_classes(const char* path, int obj_size_count, const size_t* obj_size)
+{
+	FILE  *file = NULL;
+	int    i = 0;
+	int    ret = 1;
+
+	assert(path != NULL && (obj_size != NULL || obj_size_count == 0));
+
+	if ((file = fopen(path, "w")) == NULL)
+		return 0;
+	for (i = 0; i < obj_size_count; i++)
+	{
+		if (fprintf(file, "%lu\n", (unsigned long)obj_size[i]) < 0)
+			ret = 0;
+	}
+	if (fclose(file) != 0)
+		ret = 0;
+
+	return ret;
+}
+
+/*
+** elr_mpl_save_classesıļжȡߴ#ͷע͡
+** ߴСУضȡĳߴʧʱ0
+*/
+ELR_MPL_API int elr_mpl_load_classes(const char* path, size_t* obj_size, int capacity)
+{
+	FILE          *file = NULL;
+	char           line[64];
+	unsigned long  size = 0;
+	int            n = 0;
+
+	assert(path != NULL && obj_size != NULL);
+
+	if ((file = fopen(path, "r")) == NULL)
+		return 0;
+	while (fgets(line, sizeof(line), file) != NULL)
+	{
+		if (line[0] == '#' || line[0] == '\n' || line[0] == '\r')
+			continue;
+		if (sscanf(line, "%lu", &size) != 1 || size == 0 || n == capacity
+			|| (n > 0 && size <= obj_size[n - 1]))
+		{
+			n = 0;
+			break;
+		}
+		obj_size[n++] = size;
+	}
+	fclose(file);
+
+	return n;
+}
+
+/*
+** öѲĲʣƽÿrateֽڲһڴ飬Ϊ0ʱֹͣ
+** ѲڴȻ¼ͷΪֹҪELR_USE_SAMPLING룬򷵻0
+*/
+ELR_MPL_API int elr_mpl_set_sampling(size_t rate)
+{
+#ifdef ELR_USE_SAMPLING
+	if (rate != 0)
+		g_sample_period = rate;
+	g_sample_rate = rate;
+	return 1;
+#else
+	return 0;
+#endif // ELR_USE_SAMPLING
+}
+
+/*
+** õĲڴ鰴ջܣpprofľɰʽдļ
+** 0ʾʧܡ
+*/
+ELR_MPL_API int elr_mpl_heap_dump(const char* path)
+{
+#ifdef ELR_USE_SAMPLING
+	FILE            *file = NULL;
+	elr_heap_sample *samples = NULL;
+	elr_heap_sample *sample = NULL;
+	size_t           total_size = 0;
+	size_t           size = 0;
+	size_t           n = 0;
+	size_t           i = 0;
+	size_t           j = 0;
+	int              k = 0;
+	int              ret = 1;
+#if defined(__linux__)
+	FILE            *maps = NULL;
+	char             buf[4096];
+#endif
+
+	assert(path != NULL);
+
+	/*ڸƲ¼дļʱͷ*/
+#ifdef ELR_USE_THREAD
+	elr_mtx_lock(&g_sample_mutex);
+#endif // ELR_USE_THREAD
+	samples = (elr_heap_sample*)malloc((g_sample_count + 1) * sizeof(elr_heap_sample));
+	for (i = 0; samples != NULL && i < ELR_SAMPLE_BUCKETS; i++)
+	{
+		for (sample = g_samples[i]; sample != NULL; sample = sample->next)
+		{
+			samples[n++] = *sample;
+			total_size += sample->size;
+		}
+	}
+#ifdef ELR_USE_THREAD
+	elr_mtx_unlock(&g_sample_mutex);
+#endif // ELR_USE_THREAD
+	if (samples == NULL)
+		return 0;
+	if ((file = fopen(path, "w")) == NULL)
+	{
+		free(samples);
+		return 0;
+	}
+
+	/*ջͬļ¼һ𣬺ϲΪһ*/
+	qsort(samples, n, sizeof(elr_heap_sample), _elr_sample_compare);
+	fprintf(file, "heap profile: %lu: %lu [0: 0] @ heap_v2/%lu\n",
+		(unsigned long)n, (unsigned long)total_size, (unsigned long)g_sample_period);
+	for (i = 0; i < n; i = j)
+	{
+		size = 0;
+		for (j = i; j < n && _elr_sample_compare(&samples[i], &samples[j]) == 0; j++)
+			size += samples[j].size;
+		fprintf(file, "%lu: %lu [0: 0] @", (unsigned long)(j - i), (unsigned long)size);
+		for (k = 0; k < samples[i].depth; k++)
+			fprintf(file, " 0x%lx", (unsigned long)(size_t)samples[i].stack[k]);
+		fputc('\n', file);
+	}
+	free(samples);
+
+#if defined(__linux__)
+	/*pprofӳѵַӦִļ͹*/
+	fprintf(file, "\nMAPPED_LIBRARIES:\n");
+	if ((maps = fopen("/proc/self/maps", "r")) != NULL)
+	{
+		while ((n = fread(buf, 1, sizeof(buf), maps)) > 0)
+			fwrite(buf, 1, n, file);
+		fclose(maps);
+	}
+#endif
+
+	if (ferror(file))
+		ret = 0;
+	if (fclose(file) != 0)
+		ret = 0;
+	return ret;
+#else
+	return 0;
+#endif // ELR_USE_SAMPLING
+}
+
+#ifdef ELR_USE_SAMPLING
+/*
+** ӾֵΪrateֲָ-ln(u)*rateu(0,1]Ͼȷֲ
+** ln(u)k*ln2[0.5,1)ϵln(m)֮ͣatanh㣬ѧ⡣
+*/
+size_t _elr_sample_interval(unsigned int *seed, size_t rate)
+{
+	double  u = 0;
+	double  z = 0;
+	double  z2 = 0;
+	double  ln = 0;
+
+	*seed = *seed * 1103515245u + 12345u;
+	u = (double)(((*seed >> 8) & 0xFFFFFF) + 1) / 16777216.0;
+	while (u < 0.5)
+	{
+		u *= 2;
+		ln -= 0.69314718055994531;
+	}
+	z = (u - 1) / (u + 1);
+	z2 = z * z;
+	ln += 2 * z * (1 + z2 * (1.0 / 3 + z2 * (1.0 / 5 + z2 * (1.0 / 7 + z2 / 9))));
+
+	return -ln * rate < 1 ? 1 : (size_t)(-ln * rate);
+}
+
+/*
+** ÿ̼߳¼һβҪֽֽʱڴ顣
+** ڴ鼸ܱpprofʻԭʵʵֽ
+** ڴغ;ڴصڴûпԱǵƬͷ
+*/
+void _elr_sample_alloc(elr_mem_pool *pool, void *mem, size_t size)
+{
+	elr_heap_sample *sample = NULL;
+	elr_mem_slice   *slice = NULL;
+	size_t          *left = NULL;
+	unsigned int    *seed = NULL;
+	size_t           rate = g_sample_rate;
+	size_t           index = 0;
+#ifdef ELR_USE_THREAD
+	elr_thread_ctx  *ctx = NULL;
+#endif // ELR_USE_THREAD
+#if !defined(_WIN32) && defined(__GLIBC__)
+	void            *stack[ELR_SAMPLE_MAX_DEPTH + ELR_SAMPLE_SKIP_FRAMES];
+	int              depth = 0;
+#endif
+
+	if (rate == 0 || pool->compact == 1 || pool->arena == 1)
+		return;
+
+#ifdef ELR_USE_THREAD
+	if ((ctx = _elr_thread_ctx()) == NULL)
+		return;
+	left = &ctx->sample_left;
+	seed = &ctx->sample_seed;
+#else
+	left = &g_sample_left;
+	seed = &g_sample_seed;
+#endif // ELR_USE_THREAD
+
+	if (*left == 0)
+		*left = _elr_sample_interval(seed, rate);
+	if (*left > size)
+	{
+		*left -= size;
+		return;
+	}
+	*left = _elr_sample_interval(seed, rate);
+
+	if ((sample = (elr_heap_sample*)malloc(sizeof(elr_heap_sample))) == NULL)
+		return;
+	sample->mem = mem;
+	sample->pool = pool;
+	sample->size = size;
+#if defined(_WIN32)
+	sample->depth = (int)CaptureStackBackTrace(ELR_SAMPLE_SKIP_FRAMES,
+		ELR_SAMPLE_MAX_DEPTH, sample->stack, NULL);
+#elif defined(__GLIBC__)
+	depth = backtrace(stack, ELR_SAMPLE_MAX_DEPTH + ELR_SAMPLE_SKIP_FRAMES);
+	sample->depth = depth > ELR_SAMPLE_SKIP_FRAMES ? depth - ELR_SAMPLE_SKIP_FRAMES : 0;
+	memcpy(sample->stack, stack + ELR_SAMPLE_SKIP_FRAMES, sample->depth * sizeof(void*));
+#else
+	sample->depth = 0;
+#endif
+
+	index = ELR_SAMPLE_BUCKET(mem);
+#ifdef ELR_USE_THREAD
+	elr_mtx_lock(&g_sample_mutex);
+#endif // ELR_USE_THREAD
+	sample->next = g_samples[index];
+	g_samples[index] = sample;
+	g_sample_count++;
+#ifdef ELR_USE_THREAD
+	elr_mtx_unlock(&g_sample_mutex);
+#endif // ELR_USE_THREAD
+
+	slice = (elr_mem_slice*)((char*)mem - ELR_ALIGN(sizeof(elr_mem_slice), sizeof(int)));
+	slice->sampled = 1;
+}
+
+/*
+** ɾڴĲ¼
+*/
+void _elr_sample_remove(void *mem)
+{
+	elr_heap_sample **link = NULL;
+	elr_heap_sample  *sample = NULL;
+
+#ifdef ELR_USE_THREAD
+	elr_mtx_lock(&g_sample_mutex);
+#endif // ELR_USE_THREAD
+	for (link = &g_samples[ELR_SAMPLE_BUCKET(mem)]; *link != NULL; link = &(*link)->next)
+	{
+		if ((*link)->mem == mem)
+		{
+			sample = *link;
+			*link = sample->next;
+			g_sample_count--;
+			break;
+		}
+	}
+#ifdef ELR_USE_THREAD
+	elr_mtx_unlock(&g_sample_mutex);
+#endif // ELR_USE_THREAD
+
+	free(sample);
+}
+
+/*
+** ڴӳ䵽µַ󣬰Ѳ¼Ƶµַջֲ䡣
+*/
+void _elr_sample_move(void *mem, void *new_mem, size_t size)
+{
+	elr_heap_sample **link = NULL;
+	elr_heap_sample  *sample = NULL;
+	size_t            index = ELR_SAMPLE_BUCKET(new_mem);
+
+#ifdef ELR_USE_THREAD
+	elr_mtx_lock(&g_sample_mutex);
+#endif // ELR_USE_THREAD
+	for (link = &g_samples[ELR_SAMPLE_BUCKET(mem)]; *link != NULL; link = &(*link)->next)
+	{
+		if ((*link)->mem == mem)
+		{
+			sample = *link;
+			*link = sample->next;
+			sample->mem = new_mem;
+			sample->size = size;
+			sample->next = g_samples[index];
+			g_samples[index] = sample;
+			break;
+		}
+	}
+#ifdef ELR_USE_THREAD
+	elr_mtx_unlock(&g_sample_mutex);
+#endif // ELR_USE_THREAD
+}
+
+/*
+** ɾڴڴĲ¼ڴٺڴģֹʱִС
+*/
+void _elr_sample_drop(elr_mem_pool *pool)
+{
+	elr_heap_sample **link = NULL;
+	elr_heap_sample  *sample = NULL;
+	size_t            i = 0;
+
+#ifdef ELR_USE_THREAD
+	elr_mtx_lock(&g_sample_mutex);
+#endif // ELR_USE_THREAD
+	for (i = 0; i < ELR_SAMPLE_BUCKETS; i++)
+	{
+		link = &g_samples[i];
+		while ((sample = *link) != NULL)
+		{
+			if (pool == NULL || sample->pool == pool)
+			{
+				*link = sample->next;
+				g_sample_count--;
+				free(sample);
+			}
+			else
+			{
+				link = &sample->next;
+			}
+		}
+	}
+#ifdef ELR_USE_THREAD
+	elr_mtx_unlock(&g_sample_mutex);
+#endif // ELR_USE_THREAD
+}
+
+/*
+** Ȱջȡٰջַ֡Ƚ¼
+*/
+int _elr_sample_compare(const void *a, const void *b)
+{
+	const elr_heap_sample *x = (const elr_heap_sample*)a;
+	const elr_heap_sample *y = (const elr_heap_sample*)b;
+	int                    k = 0;
+
+	if (x->depth != y->depth)
+		return x->depth < y->depth ? -1 : 1;
+	for (k = 0; k < x->depth; k++)
+	{
+		if (x->stack[k] != y->stack[k])
+			return (size_t)x->stack[k] < (size_t)y->stack[k] ? -1 : 1;
+	}
+
+	return 0;
+}
+#endif // ELR_USE_SAMPLING
+
+/*
+** ȡߴڴиڴصڲƬͳƣǸߴ磬ǰߴеĳΧڴء
+** ڴصдcapacity
+*/
+ELR_MPL_API int elr_mpl_class_stats(elr_mpl_ht hpool, elr_mpl_class_stats_t* stats, int capacity)
+{
+	elr_mem_pool  *pool = NULL;
+	elr_mpl_class_stats_t temp;
+	int            count = 0;
+	int            j = 0;
+	int            k = 0;
+	size_t         i = 0;
+
+	assert(hpool == NULL || elr_mpl_avail(hpool) != 0);
+	assert(stats != NULL || capacity == 0);
+
+	if (hpool == NULL)
+		hpool = &g_multi_mem_pool;
+	pool = (elr_mem_pool*)hpool->pool;
+	assert(pool->multi != NULL);
+
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		_elr_mpl_lock(pool);
+#endif // ELR_USE_THREAD
+	for (j = 0; j < pool->multi_count; j++, count++)
+	{
+		if (count < capacity)
+			_elr_class_stats(pool->multi[j], stats + count);
+	}
+	for (i = 0; i < pool->overrange_capacity; i++)
+	{
+		if (pool->overrange[i] == NULL)
+			continue;
+		if (count < capacity)
+		{
+			_elr_class_stats(pool->overrange[i], &temp);
+			for (k = count; k > pool->multi_count
+				&& stats[k - 1].object_size > temp.object_size; k--)
+				stats[k] = stats[k - 1];
+			stats[k] = temp;
+		}
+		count++;
+	}
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		elr_mtx_unlock(&pool->pool_mutex);
+#endif // ELR_USE_THREAD
+
+	return count;
+}
+
+/*
+** ȡһڴصڲƬͳơ
+*/
+void _elr_class_stats(elr_mem_pool* pool, elr_mpl_class_stats_t* stats)
+{
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		_elr_mpl_lock(pool);
+#endif // ELR_USE_THREAD
+	stats->object_size = pool->object_size;
+	stats->slice_count = pool->live_slice_count;
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		elr_mtx_unlock(&pool->pool_mutex);
+#endif // ELR_USE_THREAD
+
+#if defined(ELR_USE_HISTOGRAM) && defined(ELR_USE_THREAD)
+	stats->request_count = (unsigned long long)elr_atomic_load64(&pool->request_count);
+	stats->requested_size = (unsigned long long)elr_atomic_load64(&pool->request_size);
+#elif defined(ELR_USE_HISTOGRAM)
+	stats->request_count = pool->request_count;
+	stats->requested_size = pool->request_size;
+#else
+	stats->request_count = 0;
+	stats->requested_size = 0;
+#endif
+	stats->wasted_size = stats->request_count * stats->object_size > stats->requested_size
+		? stats->request_count * stats->object_size - stats->requested_size : 0;
+}
+
+/*
+** ȡڴkindӳٵİٷλλ롣
+** ֱͼƣڰٷλڵͰԲֵûм¼ʱ0
+*/
+ELR_MPL_API double elr_mpl_latency(elr_mpl_ht hpool, int kind, double percentile, int recursive)
+{
+#ifdef ELR_USE_HISTOGRAM
+	elr_mem_pool  *pool = NULL;
+	size_t         counts[ELR_LATENCY_BUCKETS];
+	size_t         total = 0;
+	double         rank = 0;
+	double         below = 0;
+	double         lower = 0;
+	double         upper = 0;
+	int            j = 0;
+
+	assert(hpool == NULL || elr_mpl_avail(hpool) != 0);
+	assert(kind >= 0 && kind < ELR_MPL_LATENCY_KINDS);
+
+	memset(counts, 0, sizeof(counts));
+#ifdef ELR_USE_THREAD
+	elr_mtx_lock(&g_tree_mutex);
+#endif // ELR_USE_THREAD
+	if (hpool == NULL)
+	{
+		_elr_latency_sum(&g_mem_pool, kind, counts, 1);
+	}
+	else
+	{
+		pool = (elr_mem_pool*)hpool->pool;
+		if (pool->shards != NULL && recursive == 0)
+		{
+			_elr_latency_sum(pool, kind, counts, 0);
+			for (j = 0; j < pool->shard_count; j++)
+				_elr_latency_sum(pool->shards[j], kind, counts, 0);
+		}
+		else if (pool->multi == NULL)
+			_elr_latency_sum(pool, kind, counts, recursive);
+		else
+		{
+			for (j = 0; j < pool->multi_count; j++)
+				_elr_latency_sum(pool->multi[j], kind, counts, recursive || j == pool->multi_count - 1);
+		}
+	}
+#ifdef ELR_USE_THREAD
+	elr_mtx_unlock(&g_tree_mutex);
+#endif // ELR_USE_THREAD
+
+	for (j = 0; j < ELR_LATENCY_BUCKETS; j++)
+		total += counts[j];
+	if (total == 0)
+		return 0;
+
+	if (percentile < 0)
+		percentile = 0;
+	if (percentile > 100)
+		percentile = 100;
+	rank = (double)total * percentile / 100;
+
+	for (j = 0; j < ELR_LATENCY_BUCKETS; j++)
+	{
+		if (counts[j] > 0 && rank <= below + counts[j])
+		{
+			lower = j == 0 ? 0 : (double)(1ULL << j);
+			upper = (double)(1ULL << (j + 1));
+			return lower + (upper - lower) * (rank - below) / counts[j];
+		}
+		below += counts[j];
+	}
+
+	return (double)(1ULL << ELR_LATENCY_BUCKETS);
+#else
+	assert(hpool == NULL || elr_mpl_avail(hpool) != 0);
+	return 0;
+#endif // ELR_USE_HISTOGRAM
+}
+
+/*
+** ڴصӳֱͼ
+*/
+ELR_MPL_API void elr_mpl_latency_reset(elr_mpl_ht hpool, int recursive)
+{
+#ifdef ELR_USE_HISTOGRAM
+	elr_mem_pool  *pool = NULL;
+	int            j = 0;
+
+	assert(hpool == NULL || elr_mpl_avail(hpool) != 0);
+
+#ifdef ELR_USE_THREAD
+	elr_mtx_lock(&g_tree_mutex);
+#endif // ELR_USE_THREAD
+	if (hpool == NULL)
+	{
+		_elr_latency_reset(&g_mem_pool, 1);
+	}
+	else
+	{
+		pool = (elr_mem_pool*)hpool->pool;
+		if (pool->shards != NULL && recursive == 0)
+		{
+			_elr_latency_reset(pool, 0);
+			for (j = 0; j < pool->shard_count; j++)
+				_elr_latency_reset(pool->shards[j], 0);
+		}
+		else if (pool->multi == NULL)
+		{
+			_elr_latency_reset(pool, recursive);
+		}
+		else
+		{
+			for (j = 0; j < pool->multi_count; j++)
+				_elr_latency_reset(pool->multi[j], recursive || j == pool->multi_count - 1);
+		}
+	}
+#ifdef ELR_USE_THREAD
+	elr_mtx_unlock(&g_tree_mutex);
+#endif // ELR_USE_THREAD
+#else
+	assert(hpool == NULL || elr_mpl_avail(hpool) != 0);
+#endif // ELR_USE_HISTOGRAM
+}
+
+#ifdef ELR_USE_HISTOGRAM
+/*
+** ʱӵĵǰʱ䣬λ롣
+*/
+unsigned long long _elr_now()
+{
+#if defined(_WIN32)
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	return (unsigned long long)(now.QuadPart / g_perf_freq.QuadPart * 1000000000
+		+ now.QuadPart % g_perf_freq.QuadPart * 1000000000 / g_perf_freq.QuadPart);
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+/*
+** ӳֱͼм¼һӳ٣ns[2^k,2^(k+1))֮ʱkͰ
+** ΧļһͰ
+*/
+void _elr_latency_add(elr_mem_pool* pool, int kind, unsigned long long ns)
+{
+	int k = 0;
+
+	while (ns > 1 && k < ELR_LATENCY_BUCKETS - 1)
+	{
+		ns >>= 1;
+		k++;
+	}
+
+#ifdef ELR_USE_THREAD
+	elr_atomic_inc(&pool->latency[kind][k]);
+#else
+	pool->latency[kind][k]++;
+#endif // ELR_USE_THREAD
+}
+
+/*
+** ڴصӳֱͼֱͼԭӼ㲻Ҫ
+*/
+void _elr_latency_reset(elr_mem_pool* pool, int recursive)
+{
+	elr_mem_pool  *child = NULL;
+	int            i = 0;
+	int            k = 0;
+
+	for (i = 0; i < ELR_MPL_LATENCY_KINDS; i++)
+	{
+		for (k = 0; k < ELR_LATENCY_BUCKETS; k++)
+			pool->latency[i][k] = 0;
+	}
+
+	if (recursive == 0)
+		return;
+
+	for (child = _elr_first_child(pool); child != NULL; child = child->next)
+		_elr_latency_reset(child, 1);
+}
+
+/*
+** ڴصkindӳֱͼۼӵcountsУͳһеǰڴصڴء
+*/
+void _elr_latency_sum(elr_mem_pool* pool, int kind, size_t* counts, int recursive)
+{
+	elr_mem_pool  *child = NULL;
+	int            k = 0;
+
+	for (k = 0; k < ELR_LATENCY_BUCKETS; k++)
+#ifdef ELR_USE_THREAD
+		counts[k] += (size_t)elr_atomic_load(&pool->latency[kind][k]);
+#else
+		counts[k] += pool->latency[kind][k];
+#endif // ELR_USE_THREAD
+
+	if (recursive == 0)
+		return;
+
+	for (child = _elr_first_child(pool); child != NULL; child = child->next)
+		_elr_latency_sum(child, kind, counts, 1);
+}
+
+#ifdef ELR_USE_THREAD
+/*
+** ڴأȴʱӳֱͼ
+*/
+void _elr_mpl_lock(elr_mem_pool* pool)
+{
+	unsigned long long start = _elr_now();
+	elr_mtx_lock(&pool->pool_mutex);
+	_elr_latency_add(pool, ELR_MPL_LATENCY_LOCK, _elr_now() - start);
+}
+#endif // ELR_USE_THREAD
+#endif // ELR_USE_HISTOGRAM
+
+/*
+** ڴ㡣
+** ELR_ZERO_STREAM_SIZEֽʱмĲʹ÷ʱ洢д벻棬
+** һڴʱѻеݼȥ
+*/
+void _elr_zero(void* mem, size_t size)
+{
+#ifdef ELR_HAS_SSE2
+	char    *begin = (char*)mem;
+	char    *end = begin + size;
+	char    *p = NULL;
+	__m128i  zero;
+
+	if (size < ELR_ZERO_STREAM_SIZE)
+	{
+		memset(mem, 0, size);
+		return;
+	}
+
+	p = (char*)ELR_ALIGN((size_t)begin, 16);
+	memset(begin, 0, p - begin);
+	zero = _mm_setzero_si128();
+	for (; p + 64 <= end; p += 64)
+	{
+		_mm_stream_si128((__m128i*)p, zero);
+		_mm_stream_si128((__m128i*)(p + 16), zero);
+		_mm_stream_si128((__m128i*)(p + 32), zero);
+		_mm_stream_si128((__m128i*)(p + 48), zero);
+	}
+	_mm_sfence();
+	memset(p, 0, end - p);
+#else
+	memset(mem, 0, size);
+#endif // ELR_HAS_SSE2
+}
+
+#ifdef ELR_USE_HISTOGRAM
+/*
+** ¼һδpoolsizeֽڵ߳ģʽԭӼҪ
+*/
+void _elr_request_add(elr_mem_pool* pool, size_t size)
+{
+#ifdef ELR_USE_THREAD
+	elr_atomic_inc64(&pool->request_count);
+	elr_atomic_add64(&pool->request_size, (elr_counter64_t)size);
+#else
+	pool->request_count++;
+	pool->request_size += size;
+#endif // ELR_USE_THREAD
+}
+#endif // ELR_USE_HISTOGRAM
+
+/*
+** ߴֱͼм¼һ롣
+*/
+void _elr_profile_add(elr_mem_pool* pool, size_t size)
+{
+	size_t k = size == 0 ? 0 : (size - 1) / ELR_PROFILE_UNIT;
+
+	if (k > ELR_PROFILE_BUCKETS)
+		k = ELR_PROFILE_BUCKETS;
+#ifdef ELR_USE_THREAD
+	elr_atomic_inc64(&pool->size_profile[k]);
+#else
+	pool->size_profile[k]++;
+#endif // ELR_USE_THREAD
+}
+
+/*
+** Ƭn·ֵ
+*/
+void _elr_live_add(elr_mem_pool* pool, size_t n)
+{
+	pool->live_slice_count += n;
+	if (pool->live_slice_count > pool->peak_slice_count)
+		pool->peak_slice_count = pool->live_slice_count;
+}
+
+/*
+** ͷڴصĿڴڵֱֻʣkeep
+** ڴغڴز¼ڴڵ㣬ͷš
+** ڴڻֵڴڵ֮Ľڵ㶼ǿеġ
+*/
+size_t _elr_mpl_release_empty(elr_mem_pool* pool, size_t keep)
+{
+	size_t         released = 0;
+	elr_mem_node  *node = pool->first_node;
+	elr_mem_node  *next = NULL;
+
+	if (pool->arena == 1)
 	{
-		ret = 0;
+		if ((node = pool->newly_alloc_node) == NULL)
+			return 0;
+		for (; keep > 0 && node->next != NULL; keep--)
+			node = node->next;
+		while ((next = node->next) != NULL)
+		{
+			node->next = next->next;
+			released += next->used_slice_count;
+			_elr_node_free(pool, next);
+		}
+		return released;
 	}
-	else
+
+	while (node != NULL && pool->empty_node_count > keep)
 	{
-		pool = (elr_mem_pool*)hpool->pool;
-		pslice = (elr_mem_slice*)((char*)pool
-			- ELR_ALIGN(sizeof(elr_mem_slice),sizeof(int)));
-		if (hpool->tag != pool->slice_tag 
-			|| hpool->tag != pslice->tag)
-			ret = 0;
+		next = node->next;
+		if (node->using_slice_count == 0 && node->used_slice_count > 0)
+		{
+			released += pool->node_size;
+			_elr_free_mem_node(node);
+		}
+		node = next;
 	}
 
-	return ret;
+	return released;
 }
 
-int _elr_mpl_avail(elr_mem_pool* pool)
+/*
+** Ϊߴڴؽߴ
+** 2ݣʹELR_CLASS_INDEX_SIZE
+** k¼һС(k<<class_shift)+1ֽڵڴأʱȽ
+** ͬһڵļڴءg_multi_mem_poolڼ仹ûʱ˳ҡ
+*/
+int _elr_class_index_build(elr_mem_pool* pool)
 {
-	elr_mem_slice* pslice = NULL;
-	assert(pool != NULL);
+	size_t max_size = 0;
+	size_t k = 0;
+	int    shift = ELR_CLASS_MIN_SHIFT;
+	int    i = 0;
+	int   *class_index = NULL;
 
-	pslice = (elr_mem_slice*)((char*)pool
-		- ELR_ALIGN(sizeof(elr_mem_slice), sizeof(int)));
+	for (i = 0; i < pool->multi_count; i++)
+	{
+		if (pool->multi[i]->object_size > max_size)
+			max_size = pool->multi[i]->object_size;
+	}
+	if (max_size == 0)
+		return 1;
 
-	if (pool->slice_tag != pslice->tag)
+	while (((max_size - 1) >> shift) + 1 > ELR_CLASS_INDEX_SIZE)
+		shift++;
+
+	class_index = (int*)elr_mpl_alloc_multi(&g_multi_mem_pool,
+		(((max_size - 1) >> shift) + 1) * sizeof(int));
+	if (class_index == NULL)
 		return 0;
 
+	for (k = 0; k <= ((max_size - 1) >> shift); k++)
+	{
+		for (i = 0; i < pool->multi_count; i++)
+		{
+			if (pool->multi[i]->object_size >= (k << shift) + 1)
+				break;
+		}
+		class_index[k] = i;
+	}
+
+	pool->class_shift = shift;
+	pool->class_index_count = ((max_size - 1) >> shift) + 1;
+	pool->class_index = class_index;
 	return 1;
 }
 
 /*
-** ڴڴ档
+** ڶߴڴвҵһsizeֽڵڴص±ꡣ
+** obj_sizeС˳ʱsizeֽڵСڴء
 */
-ELR_MPL_API void*  elr_mpl_alloc(elr_mpl_ht hpool)
+int _elr_class_of(elr_mem_pool* pool, size_t size)
 {
-	elr_mem_slice *pslice = NULL;
-	elr_mem_pool  *pool = NULL;
+	size_t k = size == 0 ? 0 : (size - 1) >> pool->class_shift;
+	int    i = 0;
 
-	assert(hpool != NULL && elr_mpl_avail(hpool)!=0);
+	if (pool->class_index != NULL)
+	{
+		if (k >= pool->class_index_count)
+			return pool->multi_count;
+		i = pool->class_index[k];
+	}
 
-	pool = (elr_mem_pool*)hpool->pool;
-	pslice = _elr_slice_from_pool(pool);
+	while (i < pool->multi_count && pool->multi[i]->object_size < size)
+		i++;
 
-    if(pslice == NULL)
-        return NULL;
-    else
+	return i;
+}
+
+/*
+** һ򴴽sizeֽڵĳΧڴء
+** ΧڴڴصڴأߴELR_OVERRANGE_UNIT_SIZE
+** ԸñΪ¼ڿŶַĹϣУװʳһʱϣһ
+*/
+elr_mem_pool* _elr_overrange_pool(elr_mem_pool* pool, size_t size)
+{
+	elr_mem_pool  *parent_pool = pool->multi[pool->multi_count - 1];
+	elr_mem_pool  *alloc_pool = NULL;
+	elr_mem_pool **table = NULL;
+	size_t         units = (size + ELR_OVERRANGE_UNIT_SIZE - 1) / ELR_OVERRANGE_UNIT_SIZE;
+	size_t         capacity = 0;
+	size_t         i = 0;
+	size_t         j = 0;
+	int            sync = 0;
+
+	if (units == 0)
+		units = 1;
+
+	if (pool->overrange != NULL)
 	{
-		char *mem = (char*)pslice 
-			+ ELR_ALIGN(sizeof(elr_mem_slice),sizeof(int));
-		if (pool->on_slice_alloc != NULL)
-			pool->on_slice_alloc(mem);
+		for (i = (units * 2654435761u) & (pool->overrange_capacity - 1);
+			(alloc_pool = pool->overrange[i]) != NULL;
+			i = (i + 1) & (pool->overrange_capacity - 1))
+		{
+			if (alloc_pool->object_size == units * ELR_OVERRANGE_UNIT_SIZE)
+				return alloc_pool;
+		}
+	}
 
-		return mem;
+	if ((pool->overrange_count + 1) * 2 > pool->overrange_capacity)
+	{
+		capacity = pool->overrange_capacity == 0 ? 16 : pool->overrange_capacity * 2;
+		table = (elr_mem_pool**)calloc(capacity, sizeof(elr_mem_pool*));
+		if (table == NULL)
+			return NULL;
+		for (j = 0; j < pool->overrange_capacity; j++)
+		{
+			if ((alloc_pool = pool->overrange[j]) == NULL)
+				continue;
+			for (i = ((alloc_pool->object_size / ELR_OVERRANGE_UNIT_SIZE) * 2654435761u) & (capacity - 1);
+				table[i] != NULL; i = (i + 1) & (capacity - 1));
+			table[i] = alloc_pool;
+		}
+		free(pool->overrange);
+		pool->overrange = table;
+		pool->overrange_capacity = capacity;
 	}
+
+#ifdef ELR_USE_THREAD
+	sync = pool->sync;
+#endif // ELR_USE_THREAD
+	/*ΧڴߴڴصĶͬʽͬ*/
+	alloc_pool = _elr_mpl_create(parent_pool, units * ELR_OVERRANGE_UNIT_SIZE,
+		parent_pool->align, parent_pool->on_slice_alloc, parent_pool->on_slice_free, sync);
+	if (alloc_pool == NULL)
+		return NULL;
+	if (parent_pool->huge == 1)
+		_elr_mpl_set_huge(alloc_pool, 1);
+	alloc_pool->track = parent_pool->track;
+	alloc_pool->retain = parent_pool->retain;
+	alloc_pool->retain_low = parent_pool->retain_low;
+	alloc_pool->retain_high = parent_pool->retain_high;
+
+	for (i = (units * 2654435761u) & (pool->overrange_capacity - 1);
+		pool->overrange[i] != NULL; i = (i + 1) & (pool->overrange_capacity - 1));
+	pool->overrange[i] = alloc_pool;
+	pool->overrange_count++;
+
+	return alloc_pool;
 }
 
-ELR_MPL_API void * elr_mpl_alloc_multi(elr_mpl_ht hpool, size_t size)
+/*
+** ȡڴڴĳߴ硣
+*/
+ELR_MPL_API size_t elr_mpl_size(void* mem)
 {
-	void*          mem = NULL;
-	elr_mpl_t      alloc_mpl = ELR_MPL_INITIALIZER;
-	elr_mem_slice *slice = NULL;
-	elr_mem_pool  *pool = NULL;
-	elr_mem_pool  *parent_pool = NULL;
-	elr_mem_pool  *child_pool = NULL;
-	elr_mem_pool  *alloc_pool = NULL;
-	int i = 0;
+    elr_mem_slice *slice = NULL;
+	elr_mem_node  *node = _elr_compact_node_of(mem);
 
-	assert(hpool == NULL || elr_mpl_avail(hpool) != 0);
+	if (node != NULL)
+		return node->owner->object_size;
 
-	if (hpool == NULL)
-		hpool = &g_multi_mem_pool;
-	pool = (elr_mem_pool*)hpool->pool;
+	slice = (elr_mem_slice*)((char*)mem
+		- ELR_ALIGN(sizeof(elr_mem_slice),sizeof(int)));
+	if (slice->node->owner->large == 1)
+		return slice->node->first_avail - (char*)mem;
+    return slice->node->owner->object_size;
+}
 
-	assert(pool->multi != NULL);
+/*
+** ڴ˻ظڴءִи÷Ҳܽڴ˻ظϵͳ
+*/
+ELR_MPL_API void  elr_mpl_free(void* mem)
+{
+#ifdef ELR_USE_HISTOGRAM
+	unsigned long long start = _elr_now();
+	elr_mem_pool *pool = _elr_mpl_free(mem);
+	_elr_latency_add(pool, ELR_MPL_LATENCY_FREE, _elr_now() - start);
+#else
+	_elr_mpl_free(mem);
+#endif // ELR_USE_HISTOGRAM
+}
 
-	parent_pool = pool->multi[pool->multi_count - 1];
+/*
+** ڴ黹ڴأظڴء
+*/
+elr_mem_pool* _elr_mpl_free(void* mem)
+{
+    elr_mem_slice *slice = NULL;
+    elr_mem_node*  node = NULL;
+    elr_mem_pool*  pool = NULL;
 
+	if ((node = _elr_compact_node_of(mem)) != NULL)
+	{
+		pool = node->owner;
+		assert(_elr_mpl_avail(pool) != 0);
 #ifdef ELR_USE_THREAD
-	if(pool->sync == 1)
-		elr_mtx_lock(&pool->pool_mutex);
+		if (pool->sync == 1)
+			_elr_mpl_lock(pool);
+#endif // ELR_USE_THREAD
+		_elr_compact_release(pool, node, mem);
+#ifdef ELR_USE_THREAD
+		if (pool->sync == 1)
+			elr_mtx_unlock(&pool->pool_mutex);
 #endif // ELR_USE_THREAD
+		return pool;
+	}
 
-	for (i = 0; i < pool->multi_count; i++)
+	slice = (elr_mem_slice*)((char*)mem
+		- ELR_ALIGN(sizeof(elr_mem_slice),sizeof(int)));
+	node = slice->node;
+	pool = node->owner;
+
+	assert(_elr_mpl_avail(pool) != 0);
+
+#ifdef ELR_USE_SAMPLING
+	if (slice->sampled != 0)
+	{
+		slice->sampled = 0;
+		_elr_sample_remove(mem);
+	}
+#endif // ELR_USE_SAMPLING
+
+	if (pool->large == 1)
+	{
+		_elr_large_free(pool, slice);
+		return pool;
+	}
+
+#ifdef ELR_USE_THREAD
+	if (pool->lockfree == 1)
+	{
+		/*ʱĵڶȡǩ*/
+		elr_atomic_store_int(&slice->tag, slice->tag + 1);
+		if (pool->on_slice_free != NULL)
+			pool->on_slice_free(mem);
+		_elr_slice_push(pool, slice, slice);
+		elr_atomic_inc64(&pool->lockfree_frees);
+		return pool;
+	}
+
+	/*ӵ߲ع黹߳ѹԶͷջ*/
+	if (pool->owner_thread != 0)
 	{
-		if (pool->multi[i]->object_size >= size)
+		slice->tag++;
+		if (pool->on_slice_free != NULL)
+			pool->on_slice_free(mem);
+		if (pool->owner_thread == elr_thread_self())
 		{
-			alloc_pool = pool->multi[i];
-			break;
+			_elr_chain_release(pool, node, slice, slice, 1);
+			pool->free_count++;
+		}
+		else
+		{
+			_elr_remote_push(pool, slice);
 		}
+		return pool;
 	}
 
-	if (alloc_pool == NULL)
-	{		
-		child_pool = parent_pool->first_child;
-		while (child_pool != NULL)
+	if (pool->cache_size > 0)
+	{
+		elr_thread_cache *cache = _elr_cache_of(pool);
+		if (cache != NULL)
 		{
-			if (child_pool->object_size >= size)
-			{
-				alloc_pool = child_pool;
-				break;
-			}
-			child_pool = child_pool->next;
+			slice->tag++;
+			if (pool->on_slice_free != NULL)
+				pool->on_slice_free(mem);
+			if (cache->count == pool->cache_size)
+				_elr_cache_flush(cache, (cache->count + 1) / 2);
+			cache->slices[cache->count++] = slice;
+			cache->free_count++;
+			return pool;
 		}
 	}
 
-	if (alloc_pool == NULL)
+	if (pool->sync == 1)
+		_elr_mpl_lock(pool);
+#endif // ELR_USE_THREAD
+
+	slice->tag++;
+	if (pool->on_slice_free != NULL)
+	{
+		pool->on_slice_free(mem);
+	}
+
+	_elr_slice_release(pool, slice);
+	pool->free_count++;
+
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		elr_mtx_unlock(&pool->pool_mutex);
+#endif // ELR_USE_THREAD
+    return pool;
+}
+
+/*
+** ѷڴƬ黹ڴء
+*/
+void _elr_slice_release(elr_mem_pool *pool, elr_mem_slice *slice)
+{
+	_elr_slice_unlink(pool, slice);
+	_elr_chain_release(pool, slice->node, slice, slice, 1);
+}
+
+/*
+** ƬƬƳ
+*/
+void _elr_slice_unlink(elr_mem_pool *pool, elr_mem_slice *slice)
+{
+	if (pool->track == 0)
+		return;
+
+	if (slice->next != NULL)
+		slice->next->prev = slice->prev;
+
+	if (slice->prev != NULL)
+		slice->prev->next = slice->next;
+	else
+		pool->first_occupied_slice = slice->next;
+}
+
+/*
+** ͬһڴڵƳƬcountƬɵһνƬ
+** ͬһڴڵĿƬڿƬģµڸöεĩβ
+*/
+void _elr_chain_release(elr_mem_pool *pool,
+	elr_mem_node *node,
+	elr_mem_slice *first,
+	elr_mem_slice *last,
+	size_t count)
+{
+	node->using_slice_count -= count;
+	pool->live_slice_count -= count;
+	if (node->using_slice_count == 0)
+		pool->empty_node_count++;
+
+	if (node->using_slice_count == 0 && pool->retain == 0
+		&& g_occupation_size >= ELR_AUTO_FREE_NODE_THRESHOLD)
 	{
-		size = ELR_OVERRANGE_UNIT_SIZE*((size + ELR_OVERRANGE_UNIT_SIZE - 1) / ELR_OVERRANGE_UNIT_SIZE);
-		alloc_mpl.pool = parent_pool;
-		alloc_mpl.tag = parent_pool->slice_tag;
-		alloc_mpl = elr_mpl_create(&alloc_mpl, size, parent_pool->on_slice_alloc, parent_pool->on_slice_free);
-		alloc_pool = (elr_mem_pool*)alloc_mpl.pool;
+		_elr_free_mem_node(node);
 	}
 	else
 	{
-		alloc_mpl.pool = alloc_pool;
-		alloc_mpl.tag = alloc_pool->slice_tag;
+		if (node->free_slice_head == NULL)
+		{
+			node->free_slice_head = first;
+			node->free_slice_tail = last;
+			first->prev = NULL;
+			last->next = pool->first_free_slice;
+			if (pool->first_free_slice != NULL)
+				pool->first_free_slice->prev = last;
+			pool->first_free_slice = first;
+		}
+		else
+		{
+			last->next = node->free_slice_tail->next;
+			if (last->next != NULL)
+				last->next->prev = last;
+			node->free_slice_tail->next = first;
+			first->prev = node->free_slice_tail;
+			node->free_slice_tail = last;
+		}
+
+		if (pool->retain == 1 && pool->empty_node_count > pool->retain_high)
+			_elr_mpl_release_empty(pool, pool->retain_low);
+	}
+}
+
+/*
+** ڴڴ棬ֻһΡ
+** ƬΪպڴڵ֡
+*/
+ELR_MPL_API size_t elr_mpl_alloc_batch(elr_mpl_ht hpool, size_t n, void** mem)
+{
+	elr_mem_slice *pslice = NULL;
+	elr_mem_pool  *pool = NULL;
+	size_t         count = 0;
+	size_t         i = 0;
+
+	assert(hpool != NULL && elr_mpl_avail(hpool) != 0);
+
+	pool = (elr_mem_pool*)hpool->pool;
+
+#ifdef ELR_USE_THREAD
+	/*̻߳桢Ƭĳ̵߳ڴر*/
+	if (pool->lockfree == 1 || pool->cache_size > 0 || pool->shards != NULL
+		|| pool->owner_thread != 0)
+	{
+		for (count = 0; count < n; count++)
+		{
+			if ((mem[count] = elr_mpl_alloc(hpool)) == NULL)
+				break;
+		}
+		return count;
+	}
+
+	if (pool->sync == 1)
+		_elr_mpl_lock(pool);
+#endif // ELR_USE_THREAD
+
+	while (count < n && pool->arena == 1)
+	{
+		if ((mem[count] = _elr_arena_alloc(pool, pool->object_size)) == NULL)
+			break;
+		count++;
+	}
+
+	while (count < n && pool->compact == 1)
+	{
+		if ((mem[count] = _elr_compact_take(pool)) == NULL)
+			break;
+		count++;
+	}
+
+	while (count < n && pool->compact == 0 && pool->arena == 0)
+	{
+		if (pool->first_free_slice != NULL)
+		{
+			pslice = _elr_slice_take(pool);
+			mem[count++] = (char*)pslice
+				+ ELR_ALIGN(sizeof(elr_mem_slice), sizeof(int));
+		}
+		else
+		{
+			if (pool->newly_alloc_node == NULL)
+				_elr_alloc_mem_node(pool);
+			if (pool->newly_alloc_node == NULL)
+				break;
+			count += _elr_slices_from_node(pool, n - count, mem + count);
+		}
+	}
+	pool->alloc_count += count;
+
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		elr_mtx_unlock(&pool->pool_mutex);
+#endif // ELR_USE_THREAD
+
+	if (pool->on_slice_alloc != NULL)
+	{
+		for (i = 0; i < count; i++)
+			pool->on_slice_alloc(mem[i]);
+	}
+
+	return count;
+}
+
+/*
+** ڴڵcountƬάƬʱһν롣
+*/
+size_t _elr_slices_from_node(elr_mem_pool *pool, size_t count, void** mem)
+{
+	elr_mem_node  *node = pool->newly_alloc_node;
+	elr_mem_slice *pslice = NULL;
+	elr_mem_slice *first = NULL;
+	elr_mem_slice *prev = NULL;
+	size_t         i = 0;
+
+	if (count > pool->slice_count - node->used_slice_count)
+		count = pool->slice_count - node->used_slice_count;
+
+	for (i = 0; i < count; i++)
+	{
+		pslice = (elr_mem_slice*)node->first_avail;
+		pslice->tag = 1;
+		pslice->node = node;
+#ifdef ELR_USE_SAMPLING
+		pslice->sampled = 0;
+#endif // ELR_USE_SAMPLING
+		pslice->next = NULL;
+		pslice->prev = prev;
+		if (prev != NULL)
+			prev->next = pslice;
+		else
+			first = pslice;
+		prev = pslice;
+		node->first_avail += pool->slice_size;
+		mem[i] = (char*)pslice + ELR_ALIGN(sizeof(elr_mem_slice), sizeof(int));
 	}
 
-	if (alloc_pool != NULL)
+	if (count > 0)
 	{
-		mem = elr_mpl_alloc(&alloc_mpl);
+		if (node->using_slice_count == 0 && node->used_slice_count > 0)
+			pool->empty_node_count--;
+		node->used_slice_count += count;
+		node->using_slice_count += count;
+		_elr_live_add(pool, count);
 	}
 
-#ifdef ELR_USE_THREAD
-	if (pool->sync == 1)
-		elr_mtx_unlock(&pool->pool_mutex);
-#endif // ELR_USE_THREAD
-	return mem;
-}
+	if (count > 0 && pool->track == 1)
+	{
+		pslice->next = pool->first_occupied_slice;
+		if (pool->first_occupied_slice != NULL)
+			pool->first_occupied_slice->prev = pslice;
+		pool->first_occupied_slice = first;
+	}
 
+	if (node->used_slice_count == pool->slice_count)
+		pool->newly_alloc_node = NULL;
 
-/*
-** ȡڴڴĳߴ硣
-*/
-ELR_MPL_API size_t elr_mpl_size(void* mem)
-{
-    elr_mem_slice *slice = (elr_mem_slice*)((char*)mem
-		- ELR_ALIGN(sizeof(elr_mem_slice),sizeof(int)));
-    return slice->node->owner->object_size;
+	return count;
 }
 
 /*
-** ڴ˻ظڴءִи÷Ҳܽڴ˻ظϵͳ
+** ڴ˻ظڴء
+** ͬһڴصڴֻһΣͬһڴڵڴ
+** һνƬ
 */
-ELR_MPL_API void  elr_mpl_free(void* mem)
+ELR_MPL_API void elr_mpl_free_batch(void** mem, size_t n)
 {
-    elr_mem_slice *slice = (elr_mem_slice*)((char*)mem 
-		- ELR_ALIGN(sizeof(elr_mem_slice),sizeof(int)));
-    elr_mem_node*  node = slice->node;
-    elr_mem_pool*  pool = node->owner;
-
-	assert(_elr_mpl_avail(pool) != 0);
+	elr_mem_slice *slice = NULL;
+	elr_mem_slice *first = NULL;
+	elr_mem_slice *last = NULL;
+	elr_mem_node  *node = NULL;
+	elr_mem_pool  *pool = NULL;
+	size_t         i = 0;
+	size_t         j = 0;
 
+	while (i < n)
+	{
+		if ((node = _elr_compact_node_of(mem[i])) != NULL)
+		{
+			pool = node->owner;
+			assert(_elr_mpl_avail(pool) != 0);
 #ifdef ELR_USE_THREAD
-	if (pool->sync == 1)
-		elr_mtx_lock(&pool->pool_mutex);
+			if (pool->sync == 1)
+				_elr_mpl_lock(pool);
+#endif // ELR_USE_THREAD
+			do
+			{
+				_elr_compact_release(pool, node, mem[i++]);
+			} while (i < n && (node = _elr_compact_node_of(mem[i])) != NULL
+				&& node->owner == pool);
+#ifdef ELR_USE_THREAD
+			if (pool->sync == 1)
+				elr_mtx_unlock(&pool->pool_mutex);
 #endif // ELR_USE_THREAD
+			continue;
+		}
 
-	slice->tag++;
-	node->using_slice_count--;
-	if (pool->on_slice_free != NULL)
-	{
-		pool->on_slice_free(mem);
-	}
+		slice = (elr_mem_slice*)((char*)mem[i]
+			- ELR_ALIGN(sizeof(elr_mem_slice), sizeof(int)));
+		pool = slice->node->owner;
 
-	if (slice->next != NULL)
-		slice->next->prev = slice->prev;
+		assert(_elr_mpl_avail(pool) != 0);
 
-	if (slice->prev != NULL)
-		slice->prev->next = slice->next;
-	else
-		pool->first_occupied_slice = slice->next;
+		if (pool->large == 1)
+		{
+			elr_mpl_free(mem[i++]);
+			continue;
+		}
 
-	if (node->using_slice_count == 0
-		&& g_occupation_size >= ELR_AUTO_FREE_NODE_THRESHOLD)
-	{
-		_elr_free_mem_node(node);
-	}
-	else
-	{
-		if (node->free_slice_head == NULL)
+#ifdef ELR_USE_THREAD
+		if (pool->lockfree == 1 || pool->cache_size > 0 || pool->owner_thread != 0)
 		{
-			node->free_slice_head = slice;
-			node->free_slice_tail = slice;
-			slice->prev = NULL;
-			slice->next = pool->first_free_slice;
-			if (pool->first_free_slice != NULL)
-				pool->first_free_slice->prev = slice;
-			pool->first_free_slice = slice;
+			elr_mpl_free(mem[i++]);
+			continue;
 		}
-		else
+
+		if (pool->sync == 1)
+			_elr_mpl_lock(pool);
+#endif // ELR_USE_THREAD
+
+		while (i < n)
 		{
-			slice->next = node->free_slice_tail->next;
-			if (slice->next != NULL)
-				slice->next->prev = slice;
-			node->free_slice_tail->next = slice;
-			slice->prev = node->free_slice_tail;
-			node->free_slice_tail = slice;
+			slice = (elr_mem_slice*)((char*)mem[i]
+				- ELR_ALIGN(sizeof(elr_mem_slice), sizeof(int)));
+			node = slice->node;
+			if (_elr_compact_node_of(mem[i]) != NULL || node->owner != pool)
+				break;
+
+			first = NULL;
+			last = NULL;
+			for (j = i; j < n; j++)
+			{
+				slice = (elr_mem_slice*)((char*)mem[j]
+					- ELR_ALIGN(sizeof(elr_mem_slice), sizeof(int)));
+				if (_elr_compact_node_of(mem[j]) != NULL || slice->node != node)
+					break;
+
+				slice->tag++;
+#ifdef ELR_USE_SAMPLING
+				if (slice->sampled != 0)
+				{
+					slice->sampled = 0;
+					_elr_sample_remove(mem[j]);
+				}
+#endif // ELR_USE_SAMPLING
+				if (pool->on_slice_free != NULL)
+					pool->on_slice_free(mem[j]);
+				_elr_slice_unlink(pool, slice);
+
+				slice->next = NULL;
+				slice->prev = last;
+				if (last != NULL)
+					last->next = slice;
+				else
+					first = slice;
+				last = slice;
+			}
+
+			_elr_chain_release(pool, node, first, last, j - i);
+			pool->free_count += j - i;
+			i = j;
 		}
-	}
 
 #ifdef ELR_USE_THREAD
-	if (pool->sync == 1)
-		elr_mtx_unlock(&pool->pool_mutex);
+		if (pool->sync == 1)
+			elr_mtx_unlock(&pool->pool_mutex);
 #endif // ELR_USE_THREAD
-    return;
+	}
 }
 
 /*
@@ -671,27 +4406,38 @@ ELR_MPL_API void elr_mpl_destroy(elr_mpl_ht hpool)
 	assert(pool->parent != NULL);
 
 #ifdef ELR_USE_THREAD
+	/*ڴʱиڴصg_tree_mutex֤ڴز*/
+	elr_mtx_lock(&g_tree_mutex);
+	/*̻߳ڴصȡڴ֮ǰʹʧЧ*/
+	if (pool->multi != NULL)
+	{
+		for (j = 0; j < pool->multi_count; j++)
+			_elr_mpl_drop_caches(pool->multi[j]);
+	}
+	else
+	{
+		_elr_mpl_drop_caches(pool);
+	}
+
 	if (pool->sync == 1)
-		elr_mtx_lock(&pool->pool_mutex);
+		_elr_mpl_lock(pool);
 #endif // ELR_USE_THREAD
 
+	/*multipoolmulti[0]poolһͷţpool*/
 	if (pool->multi != NULL)
 	{
-		for (j = 0; j < pool->multi_count; j++)
+		for (j = pool->multi_count - 1; j > 0; j--)
 		{
 			_elr_mpl_destory(pool->multi[j], 0, 0);
 		}
 	}
-	else
-	{
-		_elr_mpl_destory(pool, 0, 1);
-	}
+	/*poolʱֹ֮ٷpool*/
+	_elr_mpl_destory(pool, 0, 1);
 
 	hpool->pool = NULL;
 	hpool->tag = 0;
 #ifdef ELR_USE_THREAD
-	if (pool->sync == 1)
-		elr_mtx_unlock(&pool->pool_mutex);
+	elr_mtx_unlock(&g_tree_mutex);
 #endif // ELR_USE_THREAD    
 }
 
@@ -702,86 +4448,482 @@ ELR_MPL_API void elr_mpl_destroy(elr_mpl_ht hpool)
 ELR_MPL_API void elr_mpl_finalize()
 {
 #ifdef ELR_USE_THREAD
-	elr_counter_t   refs = 1;
-    elr_mtx_lock(&g_mem_pool.pool_mutex);
+	elr_counter_t     refs = 1;
+	elr_thread_ctx   *ctx = NULL;
+	elr_thread_cache *cache = NULL;
+
 	refs = elr_atomic_dec(&g_mpl_refs);
-    if(refs == 0)
-    {
+	if (refs != 0)
+		return;
+
+	/*ͷ߳ĺ̻߳棬֮߳˳صٷ*/
+	_elr_mpl_drop_caches(&g_mem_pool);
+	elr_mtx_lock(&g_cache_mutex);
+	g_cache_alive = 0;
+	while ((ctx = g_first_thread_ctx) != NULL)
+	{
+		g_first_thread_ctx = ctx->next;
+		while ((cache = ctx->first_cache) != NULL)
+		{
+			ctx->first_cache = cache->next;
+			free(cache);
+		}
+		free(ctx);
+	}
+	elr_mtx_unlock(&g_cache_mutex);
+	elr_tls_finalize(&g_cache_key);
+	elr_mtx_finalize(&g_cache_mutex);
+
+    elr_mtx_lock(&g_mem_pool.pool_mutex);
+	_elr_mpl_destory(&g_mem_pool, 0, 1);
+	_elr_chunk_map_free();
+	elr_mtx_finalize(&g_chunk_mutex);
+	elr_mtx_finalize(&g_tree_mutex);
+#ifdef ELR_USE_SAMPLING
+	g_sample_rate = 0;
+	_elr_sample_drop(NULL);
+	elr_mtx_finalize(&g_sample_mutex);
+#endif // ELR_USE_SAMPLING
 #else
 	g_mpl_refs--;
 	if(g_mpl_refs == 0)
 	{
-#endif // ELR_USE_THREAD
 		_elr_mpl_destory(&g_mem_pool, 0, 1);
+		_elr_chunk_map_free();
+#ifdef ELR_USE_SAMPLING
+		g_sample_rate = 0;
+		_elr_sample_drop(NULL);
+#endif // ELR_USE_SAMPLING
+    }
+#endif // ELR_USE_THREAD
+}
+
+
+void _elr_alloc_mem_node(elr_mem_pool *pool)
+{
+#ifdef ELR_USE_HISTOGRAM
+	unsigned long long start = _elr_now();
+    elr_mem_node* pnode = _elr_node_alloc(pool);
+	_elr_latency_add(pool, ELR_MPL_LATENCY_REFILL, _elr_now() - start);
+#else
+    elr_mem_node* pnode = _elr_node_alloc(pool);
+#endif // ELR_USE_HISTOGRAM
+    if(pnode == NULL)
+        return;
+
+	g_occupation_size += pool->node_size;
+	pool->node_alloc_count++;
+    pool->newly_alloc_node = pnode;
+    pnode->owner = pool;
+    pnode->first_avail = (char*)pnode + _elr_node_head(pool);
+
+	pnode->free_slice_head = NULL;
+    pnode->free_slice_tail = NULL;
+    pnode->used_slice_count = 0;
+	pnode->using_slice_count = 0;
+	pnode->prev = NULL;
+
+    if(pool->first_node == NULL)
+    {
+        pool->first_node = pnode;
+        pnode->next = NULL;		
     }
+    else
+    {
+        pnode->next = pool->first_node;
+        pool->first_node->prev = pnode;
+        pool->first_node = pnode;
+    }
+}
+
+/*ƳһδʹõNODE*/
+void _elr_free_mem_node(elr_mem_node* pnode)
+{
+	assert(pnode->using_slice_count == 0);
+
+	if (pnode->used_slice_count > 0)
+		pnode->owner->empty_node_count--;
+
+	if (pnode->free_slice_head != NULL)
+	{
+		if (pnode->free_slice_tail->next != NULL)
+			pnode->free_slice_tail->next->prev = pnode->free_slice_head->prev;
+
+		if (pnode->free_slice_head->prev != NULL)
+			pnode->free_slice_head->prev->next = pnode->free_slice_tail->next;
+
+		if (pnode->owner->first_free_slice == pnode->free_slice_head)
+			pnode->owner->first_free_slice = pnode->free_slice_tail->next;
+	}
+
+	if (pnode->owner->newly_alloc_node == pnode)
+		pnode->owner->newly_alloc_node = NULL;
+
+	if (pnode->next != NULL)
+		pnode->next->prev = pnode->prev;
+
+	if (pnode->prev != NULL)
+		pnode->prev->next = pnode->next;
+	else
+		pnode->owner->first_node = pnode->next;
+
+	g_occupation_size -= pnode->owner->node_size;
+	_elr_node_free(pnode->owner, pnode);
+}
+
+/*
+** ڴڵнڵͷռݵֽ
+** жҪʱڵͷĴСʹһڴƬڴ鰴Ҫ롣
+*/
+size_t _elr_node_head(elr_mem_pool *pool)
+{
+	size_t slice_head = ELR_ALIGN(sizeof(elr_mem_slice), sizeof(int));
+
+	if (pool->compact == 1)
+		return ELR_COMPACT_NODE_HEAD;
+
+	if (pool->arena == 1)
+		return ELR_ARENA_NODE_HEAD;
+
+	if (pool->align > 0)
+		return ELR_ALIGN(sizeof(elr_mem_node) + slice_head, pool->align) - slice_head;
+
+	return ELR_ALIGN(sizeof(elr_mem_node), sizeof(int));
+}
+
+/*
+** ϵͳڴڵڴ档
+** ڴصڴڵ㰴ELR_COMPACT_NODE_SIZE룬ǼǵַУ
+** Ҫ󳬹mallocĶʱڴڵ㰴Ҫ룻
+** ʹôҳڴصڴڵֱӳ䡣
+*/
+elr_mem_node* _elr_node_alloc(elr_mem_pool *pool)
+{
+	elr_mem_node *node = NULL;
+	size_t        align = pool->compact == 1 ? ELR_COMPACT_NODE_SIZE : pool->align;
+
+	if (pool->huge == 1)
+		return (elr_mem_node*)_elr_map_huge(pool->node_size);
+
+	if (align <= ELR_MALLOC_ALIGN)
+#ifdef ELR_NODE_ALLOC
+		return (elr_mem_node*)ELR_NODE_ALLOC(pool->node_size);
+#else
+		return (elr_mem_node*)malloc(pool->node_size);
+#endif // ELR_NODE_ALLOC
+
+#if defined(_MSC_VER) || defined(__MINGW32__)
+	node = (elr_mem_node*)_aligned_malloc(pool->node_size, align);
+#else
+	if (posix_memalign((void**)&node, align, pool->node_size) != 0)
+		node = NULL;
+#endif
+	if (node != NULL && pool->compact == 1 && _elr_chunk_map_set(node, 1) == 0)
+	{
+		_elr_node_free(pool, node);
+		node = NULL;
+	}
+
+	return node;
+}
+
+/*
+** ڴڵڴ黹ϵͳڴڵͬʱӵַע
+** ڴڴغʹôҳڴصĽڵӳ䡣
+** ǼʧܵĽڵҲͷţעδǼǵĽڵ㲻޸ĵַ
+*/
+void _elr_node_free(elr_mem_pool *pool, elr_mem_node *node)
+{
+	size_t align = pool->compact == 1 ? ELR_COMPACT_NODE_SIZE : pool->align;
+
+	if (pool->arena == 1)
+	{
+		g_occupation_size -= node->used_slice_count;
+		free(node);
+		return;
+	}
+
+	if (pool->large == 1)
+	{
+		g_occupation_size -= node->first_avail - (char*)node;
+		_elr_unmap(node, node->first_avail - (char*)node);
+		return;
+	}
+
+	if (pool->huge == 1)
+	{
+		_elr_unmap(node, pool->node_size);
+		return;
+	}
+
+	if (align <= ELR_MALLOC_ALIGN)
+	{
+#ifdef ELR_NODE_ALLOC
+		ELR_NODE_FREE(node, pool->node_size);
+#else
+		free(node);
+#endif // ELR_NODE_ALLOC
+		return;
+	}
+
+	if (pool->compact == 1)
+		_elr_chunk_map_set(node, 0);
+#if defined(_MSC_VER) || defined(__MINGW32__)
+	_aligned_free(node);
+#else
+	free(node);
+#endif
+}
+
+/*
+** ڽڴڵַеǼǻעһڴڵ㡣
+** ַĶλͼڵһõʱ룬ֱڴģֹͷš
+*/
+int _elr_chunk_map_set(elr_mem_node *node, int on)
+{
+	size_t        index = (size_t)node >> ELR_COMPACT_NODE_SHIFT;
+	size_t        top = (index >> ELR_CHUNK_MAP_BITS);
+	size_t        bit = index & ((1 << ELR_CHUNK_MAP_BITS) - 1);
+	unsigned int *leaf = NULL;
+	int           ret = 1;
+
+	/*ַΧĵַΪڴڵ*/
+	if (top >= ((size_t)1 << ELR_CHUNK_MAP_BITS))
+		return 0;
+
+#ifdef ELR_USE_THREAD
+	elr_mtx_lock(&g_chunk_mutex);
+#endif // ELR_USE_THREAD
+	leaf = g_chunk_map[top];
+	if (leaf == NULL && on == 1)
+	{
+		leaf = (unsigned int*)calloc(ELR_CHUNK_LEAF_WORDS, sizeof(unsigned int));
+		g_chunk_map[top] = leaf;
+	}
 
+	if (leaf == NULL)
+	{
+		ret = 0;
+	}
+	else if (on == 1)
+	{
+		leaf[bit / (8 * sizeof(unsigned int))] |= 1u << (bit % (8 * sizeof(unsigned int)));
+#ifdef ELR_USE_THREAD
+		elr_atomic_inc(&g_compact_node_count);
+#else
+		g_compact_node_count++;
+#endif // ELR_USE_THREAD
+	}
+	else if ((leaf[bit / (8 * sizeof(unsigned int))] 
+		& (1u << (bit % (8 * sizeof(unsigned int))))) != 0)
+	{
+		leaf[bit / (8 * sizeof(unsigned int))] &= ~(1u << (bit % (8 * sizeof(unsigned int))));
+#ifdef ELR_USE_THREAD
+		elr_atomic_dec(&g_compact_node_count);
+#else
+		g_compact_node_count--;
+#endif // ELR_USE_THREAD
+	}
 #ifdef ELR_USE_THREAD
-    elr_mtx_unlock(&g_mem_pool.pool_mutex);
+	elr_mtx_unlock(&g_chunk_mutex);
 #endif // ELR_USE_THREAD
+
+	return ret;
+}
+
+/*
+** ͷŽڴڵַжλͼڴģֹʱִС
+*/
+void _elr_chunk_map_free()
+{
+	size_t i = 0;
+
+	for (i = 0; i < ((size_t)1 << ELR_CHUNK_MAP_BITS); i++)
+	{
+		if (g_chunk_map[i] != NULL)
+		{
+			free(g_chunk_map[i]);
+			g_chunk_map[i] = NULL;
+		}
+	}
+}
+
+/*
+** ȡڴĽڴڵ㡣
+** ûнڴڵʱѯַͨڴصͷֻһжϡ
+*/
+elr_mem_node* _elr_compact_node_of(const void *mem)
+{
+	size_t        index = 0;
+	size_t        top = 0;
+	size_t        bit = 0;
+	unsigned int *leaf = NULL;
+
+	if (g_compact_node_count == 0)
+		return NULL;
+
+	index = (size_t)mem >> ELR_COMPACT_NODE_SHIFT;
+	top = index >> ELR_CHUNK_MAP_BITS;
+	bit = index & ((1 << ELR_CHUNK_MAP_BITS) - 1);
+	if (top >= ((size_t)1 << ELR_CHUNK_MAP_BITS)
+		|| (leaf = g_chunk_map[top]) == NULL)
+		return NULL;
+
+	if ((leaf[bit / (8 * sizeof(unsigned int))] 
+		& (1u << (bit % (8 * sizeof(unsigned int))))) == 0)
+		return NULL;
+
+	return (elr_mem_node*)((size_t)mem & ~((size_t)ELR_COMPACT_NODE_SIZE - 1));
 }
 
+/*
+** ӽڴȡһڴ顣
+** ȡڴٴڴڵл֣ڴڵ㲻Զ黹ϵͳ
+*/
+void* _elr_compact_take(elr_mem_pool *pool)
+{
+	void         *mem = NULL;
+	elr_mem_node *node = NULL;
+
+	if (pool->first_free_object != NULL)
+	{
+		mem = pool->first_free_object;
+		pool->first_free_object = *(void**)mem;
+		node = (elr_mem_node*)((size_t)mem & ~((size_t)ELR_COMPACT_NODE_SIZE - 1));
+		node->using_slice_count++;
+		_elr_live_add(pool, 1);
+		return mem;
+	}
+
+	if (pool->newly_alloc_node == NULL)
+		_elr_alloc_mem_node(pool);
+	if ((node = pool->newly_alloc_node) == NULL)
+		return NULL;
 
-void _elr_alloc_mem_node(elr_mem_pool *pool)
-{
-    elr_mem_node* pnode = (elr_mem_node*)malloc(pool->node_size);
-    if(pnode == NULL)
-        return;
+	mem = node->first_avail;
+	node->first_avail += pool->slice_size;
+	node->used_slice_count++;
+	node->using_slice_count++;
+	_elr_live_add(pool, 1);
+	if (node->used_slice_count == pool->slice_count)
+		pool->newly_alloc_node = NULL;
 
-	g_occupation_size += pool->node_size;
-    pool->newly_alloc_node = pnode;
-    pnode->owner = pool;
-    pnode->first_avail = (char*)pnode
-		+ ELR_ALIGN(sizeof(elr_mem_node),sizeof(int));
+	return mem;
+}
 
-	pnode->free_slice_head = NULL;
-    pnode->free_slice_tail = NULL;
-    pnode->used_slice_count = 0;
-	pnode->using_slice_count = 0;
-	pnode->prev = NULL;
+/*
+** ڴ黹ڴأڴǰֽӿڴ
+*/
+void _elr_compact_release(elr_mem_pool *pool, elr_mem_node *node, void *mem)
+{
+	if (pool->on_slice_free != NULL)
+		pool->on_slice_free(mem);
 
-    if(pool->first_node == NULL)
-    {
-        pool->first_node = pnode;
-        pnode->next = NULL;		
-    }
-    else
-    {
-        pnode->next = pool->first_node;
-        pool->first_node->prev = pnode;
-        pool->first_node = pnode;
-    }
+	*(void**)mem = pool->first_free_object;
+	pool->first_free_object = mem;
+	node->using_slice_count--;
+	pool->live_slice_count--;
+	pool->free_count++;
 }
 
-/*ƳһδʹõNODE*/
-void _elr_free_mem_node(elr_mem_node* pnode)
+/*
+** Ӿڴ˳򻮷sizeֽڣ߸
+** ڻֵڴڵɵµĽڵ㣬ɲʱµĽڵĩβ
+** ĬϴСĽڵɲʱһպɵµĽڵ㡣
+*/
+void* _elr_arena_alloc(elr_mem_pool *pool, size_t size)
 {
-	assert(pnode->using_slice_count == 0);
+	elr_mem_node  *node = pool->newly_alloc_node;
+	elr_mem_node  *last = NULL;
+	size_t         length = pool->node_size;
+	char          *mem = NULL;
+#ifdef ELR_USE_HISTOGRAM
+	unsigned long long start = 0;
+#endif // ELR_USE_HISTOGRAM
 
-	if (pnode->free_slice_head != NULL)
+	size = ELR_ALIGN(size == 0 ? 1 : size, ELR_MALLOC_ALIGN);
+	while (node != NULL
+		&& (size_t)((char*)node + node->used_slice_count - node->first_avail) < size)
 	{
-		if (pnode->free_slice_tail->next != NULL)
-			pnode->free_slice_tail->next->prev = pnode->free_slice_head->prev;
+		last = node;
+		node = node->next;
+	}
 
-		if (pnode->free_slice_head->prev != NULL)
-			pnode->free_slice_head->prev->next = pnode->free_slice_tail->next;
+	if (node == NULL)
+	{
+		if (size > length - ELR_ARENA_NODE_HEAD)
+			length = ELR_ARENA_NODE_HEAD + size;
+#ifdef ELR_USE_HISTOGRAM
+		start = _elr_now();
+		node = (elr_mem_node*)malloc(length);
+		_elr_latency_add(pool, ELR_MPL_LATENCY_REFILL, _elr_now() - start);
+#else
+		node = (elr_mem_node*)malloc(length);
+#endif // ELR_USE_HISTOGRAM
+		if (node == NULL)
+			return NULL;
 
-		if (pnode->owner->first_free_slice == pnode->free_slice_head)
-			pnode->owner->first_free_slice = pnode->free_slice_tail->next;
+		g_occupation_size += length;
+		pool->node_alloc_count++;
+		node->owner = pool;
+		node->first_avail = (char*)node + ELR_ARENA_NODE_HEAD;
+		node->free_slice_head = NULL;
+		node->free_slice_tail = NULL;
+		node->using_slice_count = 0;
+		node->used_slice_count = length;
+		node->prev = last;
+		node->next = NULL;
+		if (last == NULL)
+			pool->first_node = node;
+		else
+			last->next = node;
 	}
 
-	if (pnode->owner->newly_alloc_node == pnode)
-		pnode->owner->newly_alloc_node = NULL;
+	mem = node->first_avail;
+	node->first_avail += size;
+	pool->newly_alloc_node = node;
+	_elr_live_add(pool, 1);
 
-	if (pnode->next != NULL)
-		pnode->next->prev = pnode->prev;
+	return mem;
+}
 
-	if (pnode->prev != NULL)
-		pnode->prev->next = pnode->next;
+/*
+** ڴػ˵markµλã߸
+** ǵڴڵ㵽ڻֵڴڵ֮Ľڵ´ͷ֣֮Ľڵ㱾ûʹá
+** еڴڵΪNULLʾ˵һڴڵĿͷ
+*/
+void _elr_arena_rewind(elr_mem_pool *pool, const elr_mpl_mark_t *mark)
+{
+	elr_mem_node  *node = NULL;
+	elr_mem_node  *current = pool->newly_alloc_node;
+
+	if (current == NULL)
+		return;
+
+	if (mark->node == NULL)
+	{
+		node = pool->first_node;
+		node->first_avail = (char*)node + ELR_ARENA_NODE_HEAD;
+	}
 	else
-		pnode->owner->first_node = pnode->next;
+	{
+		node = (elr_mem_node*)mark->node;
+		assert(node->owner == pool);
+		node->first_avail = (char*)mark->avail;
+	}
+	pool->newly_alloc_node = node;
 
-	g_occupation_size -= pnode->owner->node_size;
-	free(pnode);
+	while (node != current)
+	{
+		node = node->next;
+		node->first_avail = (char*)node + ELR_ARENA_NODE_HEAD;
+	}
+
+	if (pool->live_slice_count > mark->count)
+	{
+		pool->free_count += pool->live_slice_count - mark->count;
+		pool->live_slice_count = mark->count;
+	}
 }
 
 elr_mem_slice* _elr_slice_from_node(elr_mem_pool *pool)
@@ -790,13 +4932,20 @@ elr_mem_slice* _elr_slice_from_node(elr_mem_pool *pool)
 
     if(pool->newly_alloc_node != NULL)
     {
+		if (pool->newly_alloc_node->using_slice_count == 0
+			&& pool->newly_alloc_node->used_slice_count > 0)
+			pool->empty_node_count--;
         pool->newly_alloc_node->used_slice_count++;
 		pool->newly_alloc_node->using_slice_count++;
+		_elr_live_add(pool, 1);
         pslice = (elr_mem_slice*)pool->newly_alloc_node->first_avail;
-		memset(pslice,0,pool->slice_size);
+		/*һλֻʼƬͷǩ1ʼ*/
 		pslice->next = NULL;
 		pslice->prev = NULL;
-		pslice->tag++;
+		pslice->tag = 1;
+#ifdef ELR_USE_SAMPLING
+		pslice->sampled = 0;
+#endif // ELR_USE_SAMPLING
         pool->newly_alloc_node->first_avail += pool->slice_size;
         pslice->node = pool->newly_alloc_node;
         if(pool->newly_alloc_node->used_slice_count == pool->slice_count)
@@ -816,9 +4965,28 @@ elr_mem_slice* _elr_slice_from_pool(elr_mem_pool* pool)
 
 #ifdef ELR_USE_THREAD
 	if (pool->sync == 1)
-		elr_mtx_lock(&pool->pool_mutex);
+		_elr_mpl_lock(pool);
+#endif // ELR_USE_THREAD
+
+	slice = _elr_slice_take(pool);
+	if (slice != NULL)
+		pool->alloc_count++;
+
+#ifdef ELR_USE_THREAD
+	if (pool->sync == 1)
+		elr_mtx_unlock(&pool->pool_mutex);
 #endif // ELR_USE_THREAD
 
+	return slice;
+}
+
+/*
+** ڴȡһڴƬƬ
+*/
+elr_mem_slice* _elr_slice_take(elr_mem_pool* pool)
+{
+    elr_mem_slice *slice = NULL;
+
     if(pool->first_free_slice != NULL)
     {
         slice = pool->first_free_slice;
@@ -837,7 +5005,10 @@ elr_mem_slice* _elr_slice_from_pool(elr_mem_pool* pool)
 		slice->next = NULL;
 		slice->prev = NULL;
 		slice->tag++;
+		if (slice->node->using_slice_count == 0)
+			pool->empty_node_count--;
 		slice->node->using_slice_count++;
+		_elr_live_add(pool, 1);
     }
     else
     {
@@ -846,7 +5017,7 @@ elr_mem_slice* _elr_slice_from_pool(elr_mem_pool* pool)
         slice = _elr_slice_from_node(pool);
     }
 
-	if (slice != NULL)
+	if (slice != NULL && pool->track == 1)
 	{
 		slice->prev = NULL;
 		slice->next = pool->first_occupied_slice;
@@ -855,14 +5026,439 @@ elr_mem_slice* _elr_slice_from_pool(elr_mem_pool* pool)
 		pool->first_occupied_slice = slice;
 	}
 
+	return slice;
+}
+
 #ifdef ELR_USE_THREAD
-	if (pool->sync == 1)
+void ELR_TLS_CALLBACK _elr_thread_exit(void* arg)
+{
+	elr_thread_ctx   *ctx = (elr_thread_ctx*)arg;
+	elr_thread_cache *cache = NULL;
+
+	if (g_cache_alive == 0)
+		return;
+
+	elr_mtx_lock(&g_cache_mutex);
+	while ((cache = ctx->first_cache) != NULL)
+	{
+		ctx->first_cache = cache->next;
+		if (cache->pool != NULL)
+		{
+			_elr_cache_flush(cache, cache->count);
+			if (cache->pool_next != NULL)
+				cache->pool_next->pool_prev = cache->pool_prev;
+			if (cache->pool_prev != NULL)
+				cache->pool_prev->pool_next = cache->pool_next;
+			else
+				cache->pool->first_cache = cache->pool_next;
+		}
+		free(cache);
+	}
+
+	if (ctx->next != NULL)
+		ctx->next->prev = ctx->prev;
+	if (ctx->prev != NULL)
+		ctx->prev->next = ctx->next;
+	else
+		g_first_thread_ctx = ctx->next;
+	elr_mtx_unlock(&g_cache_mutex);
+
+	free(ctx);
+}
+
+/*
+** ȡǰ̵߳߳ģһεʱǼǵ߳С
+*/
+elr_thread_ctx* _elr_thread_ctx()
+{
+	elr_thread_ctx   *ctx = NULL;
+
+	ctx = (elr_thread_ctx*)elr_tls_get(&g_cache_key);
+	if (ctx == NULL)
+	{
+		ctx = (elr_thread_ctx*)malloc(sizeof(elr_thread_ctx));
+		if (ctx == NULL)
+			return NULL;
+		ctx->first_cache = NULL;
+		ctx->prev = NULL;
+#ifdef ELR_USE_SAMPLING
+		ctx->sample_left = 0;
+		ctx->sample_seed = (unsigned int)(size_t)ctx;
+#endif // ELR_USE_SAMPLING
+		if (elr_tls_set(&g_cache_key, ctx) == 0)
+		{
+			free(ctx);
+			return NULL;
+		}
+		elr_mtx_lock(&g_cache_mutex);
+		ctx->next = g_first_thread_ctx;
+		if (ctx->next != NULL)
+			ctx->next->prev = ctx;
+		g_first_thread_ctx = ctx;
+		elr_mtx_unlock(&g_cache_mutex);
+	}
+
+	return ctx;
+}
+
+elr_thread_cache* _elr_cache_of(elr_mem_pool *pool)
+{
+	elr_thread_ctx   *ctx = NULL;
+	elr_thread_cache *cache = NULL;
+	elr_thread_cache *prev = NULL;
+
+	ctx = _elr_thread_ctx();
+	if (ctx == NULL)
+		return NULL;
+
+	/*ʱ˳ͷʧЧĻ棬ҵĻƵͷ*/
+	cache = ctx->first_cache;
+	while (cache != NULL)
+	{
+		if (cache->pool == pool)
+		{
+			if (prev != NULL)
+			{
+				prev->next = cache->next;
+				cache->next = ctx->first_cache;
+				ctx->first_cache = cache;
+			}
+			return cache;
+		}
+
+		if (cache->pool == NULL)
+		{
+			if (prev != NULL)
+				prev->next = cache->next;
+			else
+				ctx->first_cache = cache->next;
+			free(cache);
+			cache = prev != NULL ? prev->next : ctx->first_cache;
+		}
+		else
+		{
+			prev = cache;
+			cache = cache->next;
+		}
+	}
+
+	cache = (elr_thread_cache*)malloc(sizeof(elr_thread_cache)
+		+ pool->cache_size * sizeof(elr_mem_slice*));
+	if (cache == NULL)
+		return NULL;
+	cache->pool = pool;
+	cache->count = 0;
+	cache->alloc_count = 0;
+	cache->free_count = 0;
+	cache->slices = (elr_mem_slice**)(cache + 1);
+	cache->pool_prev = NULL;
+
+	elr_mtx_lock(&g_cache_mutex);
+	cache->pool_next = pool->first_cache;
+	if (cache->pool_next != NULL)
+		cache->pool_next->pool_prev = cache;
+	pool->first_cache = cache;
+	elr_mtx_unlock(&g_cache_mutex);
+
+	cache->next = ctx->first_cache;
+	ctx->first_cache = cache;
+
+	return cache;
+}
+
+/*
+** ΪʱһδڴȡһƬֻһΡ
+*/
+elr_mem_slice* _elr_slice_from_cache(elr_mem_pool *pool)
+{
+	elr_thread_cache *cache = NULL;
+	elr_mem_slice    *slice = NULL;
+	size_t            batch = 0;
+
+	cache = _elr_cache_of(pool);
+	if (cache == NULL)
+		return _elr_slice_from_pool(pool);
+
+	if (cache->count == 0)
+	{
+		batch = (pool->cache_size + 1) / 2;
+		_elr_mpl_lock(pool);
+		pool->alloc_count += cache->alloc_count;
+		pool->free_count += cache->free_count;
+		cache->alloc_count = 0;
+		cache->free_count = 0;
+		while (cache->count < batch
+			&& (slice = _elr_slice_take(pool)) != NULL)
+		{
+			slice->tag++;
+			cache->slices[cache->count++] = slice;
+		}
 		elr_mtx_unlock(&pool->pool_mutex);
-#endif // ELR_USE_THREAD
+
+		if (cache->count == 0)
+			return NULL;
+	}
+
+	slice = cache->slices[--cache->count];
+	slice->tag++;
+	cache->alloc_count++;
+
+	return slice;
+}
+
+/*
+** ջ׵Ƭ뻺ģȹ黹
+*/
+void _elr_cache_flush(elr_thread_cache *cache, size_t count)
+{
+	size_t         i = 0;
+	elr_mem_pool  *pool = cache->pool;
+
+	if (count == 0 && cache->alloc_count == 0 && cache->free_count == 0)
+		return;
+
+	_elr_mpl_lock(pool);
+	pool->alloc_count += cache->alloc_count;
+	pool->free_count += cache->free_count;
+	cache->alloc_count = 0;
+	cache->free_count = 0;
+	for (i = 0; i < count; i++)
+		_elr_slice_release(pool, cache->slices[i]);
+	elr_mtx_unlock(&pool->pool_mutex);
+
+	cache->count -= count;
+	memmove(cache->slices, cache->slices + count,
+		cache->count * sizeof(elr_mem_slice*));
+}
+
+/*
+** ڴؼ٣еƬڴڵһͷţҪ黹
+** ṹ߳ڲһ˳ʱͷš
+*/
+void _elr_mpl_drop_caches(elr_mem_pool *pool)
+{
+	elr_thread_cache *cache = NULL;
+	elr_mem_pool     *child = NULL;
+
+	elr_mtx_lock(&g_cache_mutex);
+	while ((cache = pool->first_cache) != NULL)
+	{
+		pool->first_cache = cache->pool_next;
+		cache->pool = NULL;
+		cache->count = 0;
+		cache->pool_prev = NULL;
+		cache->pool_next = NULL;
+	}
+	elr_mtx_unlock(&g_cache_mutex);
+
+	child = pool->first_child;
+	while (child != NULL)
+	{
+		_elr_mpl_drop_caches(child);
+		child = child->next;
+	}
+}
+
+/*
+** ջıǩȡջƬıǩƬÿη͹黹ǩ1
+** ͬһƬѹʱջֵͬABA⡣
+** ڴڵڴǰͷţȡѱ̵߳Ƭǰȫġ
+*/
+elr_mem_slice* _elr_slice_pop(elr_mem_pool *pool)
+{
+	elr_tagged_ptr  head;
+	elr_tagged_ptr  next;
+	elr_mem_slice  *slice = NULL;
+	elr_mem_slice  *last = NULL;
+	elr_mem_slice  *temp = NULL;
+	int             i = 0;
+
+	for (;;)
+	{
+		elr_atomic_load_tagged(&pool->free_stack, &head);
+		while (head.ptr != NULL)
+		{
+			/*Ƭѱ̵߳޸ģȡֵɱȽϽ*/
+			slice = (elr_mem_slice*)head.ptr;
+			next.ptr = elr_atomic_load_word((void* volatile*)&slice->next);
+			next.tag = next.ptr == NULL ? 0
+				: (size_t)elr_atomic_load_int(&((elr_mem_slice*)next.ptr)->tag);
+			if (elr_atomic_cas_tagged(&pool->free_stack, &head, next) != 0)
+			{
+				elr_atomic_store_int(&slice->tag, slice->tag + 1);
+				elr_atomic_inc64(&pool->lockfree_allocs);
+				return slice;
+			}
+		}
+
+		/*ջΪգڴڵлһƬһֱӷأѹջ*/
+		_elr_mpl_lock(pool);
+		elr_atomic_load_tagged(&pool->free_stack, &head);
+		if (head.ptr != NULL)
+		{
+			elr_mtx_unlock(&pool->pool_mutex);
+			continue;
+		}
+
+		slice = NULL;
+		last = NULL;
+		for (i = 0; i < ELR_LOCKFREE_REFILL_COUNT; i++)
+		{
+			if (pool->newly_alloc_node == NULL)
+			{
+				if (i > 0)
+					break;
+				_elr_alloc_mem_node(pool);
+			}
+			if ((temp = _elr_slice_from_node(pool)) == NULL)
+				break;
+			if (slice == NULL)
+			{
+				slice = temp;
+			}
+			else
+			{
+				temp->tag++;
+				temp->next = NULL;
+				if (last == NULL)
+					slice->next = temp;
+				else
+					last->next = temp;
+				last = temp;
+			}
+		}
+
+		if (last != NULL)
+			_elr_slice_push(pool, slice->next, last);
+		elr_mtx_unlock(&pool->pool_mutex);
+
+		if (slice != NULL)
+		{
+			slice->next = NULL;
+			elr_atomic_inc64(&pool->lockfree_allocs);
+		}
+		return slice;
+	}
+}
+
+int _elr_cpu_index()
+{
+#if defined(_WIN32)
+	return (int)GetCurrentProcessorNumber();
+#elif defined(__linux__)
+	int cpu = sched_getcpu();
+	return cpu < 0 ? 0 : cpu;
+#else
+	return 0;
+#endif
+}
+
+/*
+** ڴƬڻֳķƬͷʱڴڵص÷Ƭ
+** ǰCPUķƬûпƬδֵƬʱȴпƬķƬã
+** ûʱΪǰƬڴڵ㣬ƬĿƬõƽ⡣
+*/
+elr_mem_slice* _elr_slice_from_shards(elr_mem_pool *pool)
+{
+	elr_mem_slice *slice = NULL;
+	elr_mem_pool  *shard = NULL;
+	int            k = _elr_cpu_index() % pool->shard_count;
+	int            i = 0;
+
+	shard = pool->shards[k];
+	_elr_mpl_lock(shard);
+	if (shard->first_free_slice != NULL || shard->newly_alloc_node != NULL)
+	{
+		slice = _elr_slice_take(shard);
+		if (slice != NULL)
+			shard->alloc_count++;
+		elr_mtx_unlock(&shard->pool_mutex);
+		return slice;
+	}
+	elr_mtx_unlock(&shard->pool_mutex);
+
+	for (i = 1; i < pool->shard_count; i++)
+	{
+		shard = pool->shards[(k + i) % pool->shard_count];
+		/*ضȡֻΪʾȷ*/
+		if (shard->first_free_slice == NULL)
+			continue;
+		_elr_mpl_lock(shard);
+		if (shard->first_free_slice != NULL)
+		{
+			slice = _elr_slice_take(shard);
+			shard->alloc_count++;
+		}
+		elr_mtx_unlock(&shard->pool_mutex);
+		if (slice != NULL)
+			return slice;
+	}
+
+	return _elr_slice_from_pool(pool->shards[k]);
+}
+
+/*
+** ӵߴڴڴƬȡ߳ͷŵƬ
+** ڴصĿƬڴڵֻӵ޸ģҪ
+*/
+elr_mem_slice* _elr_slice_from_owner(elr_mem_pool *pool)
+{
+	elr_mem_slice *slice = NULL;
+
+	assert(pool->owner_thread == elr_thread_self());
+
+	if (elr_atomic_load_ptr(&pool->remote_free) != NULL)
+		_elr_remote_drain(pool);
+
+	slice = _elr_slice_take(pool);
+	if (slice != NULL)
+		pool->alloc_count++;
 
 	return slice;
 }
 
+/*
+** ߳ѹ룬ֻӵһȫȡߣABA⡣
+*/
+void _elr_remote_push(elr_mem_pool *pool, elr_mem_slice *slice)
+{
+	void *head = elr_atomic_load_ptr(&pool->remote_free);
+
+	do
+	{
+		slice->next = (elr_mem_slice*)head;
+	} while (elr_atomic_cas_ptr(&pool->remote_free, &head, slice) == 0);
+}
+
+void _elr_remote_drain(elr_mem_pool *pool)
+{
+	elr_mem_slice *slice = (elr_mem_slice*)elr_atomic_xchg_ptr(&pool->remote_free, NULL);
+	elr_mem_slice *next = NULL;
+
+	while (slice != NULL)
+	{
+		next = slice->next;
+		_elr_chain_release(pool, slice->node, slice, slice, 1);
+		pool->free_count++;
+		slice = next;
+	}
+}
+
+void _elr_slice_push(elr_mem_pool *pool, elr_mem_slice *first, elr_mem_slice *last)
+{
+	elr_tagged_ptr  head;
+	elr_tagged_ptr  top;
+
+	top.ptr = first;
+	top.tag = first->tag;
+	elr_atomic_load_tagged(&pool->free_stack, &head);
+	do
+	{
+		elr_atomic_store_word((void* volatile*)&last->next, head.ptr);
+	} while (elr_atomic_cas_tagged(&pool->free_stack, &head, top) == 0);
+}
+#endif // ELR_USE_THREAD
+
 
 void _elr_mpl_destory(elr_mem_pool *pool, int inner, int lock_this)
 {
@@ -895,10 +5491,16 @@ void _elr_mpl_destory(elr_mem_pool *pool, int inner, int lock_this)
 		_elr_mpl_destory(temp_pool, 1, lock_this);
 	}
 
+#ifdef ELR_USE_SAMPLING
+	/*ڴڴһ٣پelr_mpl_free*/
+	if (g_sample_count != 0)
+		_elr_sample_drop(pool);
+#endif // ELR_USE_SAMPLING
+
 #ifdef ELR_USE_THREAD
 	if (pool->sync == 1)
 	{
-		if (inner == 1 && lock_this == 1)
+		if (lock_this == 1)
 			elr_mtx_unlock(&(pool->pool_mutex));
 		elr_mtx_finalize(&pool->pool_mutex);
 	}
@@ -910,17 +5512,27 @@ void _elr_mpl_destory(elr_mem_pool *pool, int inner, int lock_this)
 		while(temp_slice != NULL)
 		{
 			pool->first_occupied_slice = temp_slice->next;
-			pool->on_slice_free((char*)temp_slice 
-				+ ELR_ALIGN(sizeof(elr_mem_slice),sizeof(int)));
+			/*ǩΪżƬ̻߳УѾִйص*/
+			if ((temp_slice->tag & 1) != 0)
+				pool->on_slice_free((char*)temp_slice 
+					+ ELR_ALIGN(sizeof(elr_mem_slice),sizeof(int)));
 			temp_slice = pool->first_occupied_slice;
 		}		
 	}
 
+	while((temp_node = pool->large_cache) != NULL)
+	{
+		pool->large_cache = temp_node->next;
+		_elr_node_free(pool, temp_node);
+	}
+
 	temp_node = pool->first_node;
 	while(temp_node != NULL)
 	{		
 		pool->first_node = temp_node->next;
-		free(temp_node);
+		if (pool->arena == 0)
+			g_occupation_size -= pool->node_size;
+		_elr_node_free(pool, temp_node);
 		temp_node = pool->first_node ;
 	}
 
@@ -928,6 +5540,14 @@ void _elr_mpl_destory(elr_mem_pool *pool, int inner, int lock_this)
 	pool->slice_tag = -1;
 	if(pool != g_multi_mem_pool.pool && pool->multi != NULL)
 		elr_mpl_free(pool->multi);
+	if(pool != g_multi_mem_pool.pool && pool->class_index != NULL)
+		elr_mpl_free(pool->class_index);
+	if(pool->shards != NULL)
+		elr_mpl_free(pool->shards);
+	if(pool->overrange != NULL)
+		free(pool->overrange);
+	if (pool->size_profile != NULL)
+		free(pool->size_profile);
 
 	/*Ǹڵ*/
 	if(pool != &g_mem_pool)
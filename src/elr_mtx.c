@@ -12,6 +12,98 @@ elr_counter_t elr_atomic_dec(elr_atomic_t* v)
 	return InterlockedDecrement(v);
 }
 
+elr_counter_t elr_atomic_add(elr_atomic_t* v, elr_counter_t n)
+{
+	return InterlockedExchangeAdd(v, n) + n;
+}
+
+elr_counter_t elr_atomic_load(elr_atomic_t* v)
+{
+	return InterlockedCompareExchange(v, 0, 0);
+}
+
+elr_counter64_t elr_atomic_inc64(elr_atomic64_t* v)
+{
+	return InterlockedIncrement64(v);
+}
+
+elr_counter64_t elr_atomic_add64(elr_atomic64_t* v, elr_counter64_t n)
+{
+	return InterlockedExchangeAdd64(v, n) + n;
+}
+
+/*32λϵͳ64λĶȡԭӵģñȽϽȡ*/
+elr_counter64_t elr_atomic_load64(elr_atomic64_t* v)
+{
+	return InterlockedCompareExchange64(v, 0, 0);
+}
+
+void* elr_atomic_load_ptr(elr_atomic_ptr* src)
+{
+	return InterlockedCompareExchangePointer(src, NULL, NULL);
+}
+
+void* elr_atomic_xchg_ptr(elr_atomic_ptr* dst, void* val)
+{
+	return InterlockedExchangePointer(dst, val);
+}
+
+int elr_atomic_cas_ptr(elr_atomic_ptr* dst, void** expected, void* desired)
+{
+	void* old = InterlockedCompareExchangePointer(dst, desired, *expected);
+	if (old == *expected)
+		return 1;
+
+	*expected = old;
+	return 0;
+}
+
+int elr_atomic_cas_tagged(volatile elr_tagged_ptr* dst,
+	elr_tagged_ptr* expected,
+	elr_tagged_ptr desired)
+{
+#ifdef _WIN64
+	return InterlockedCompareExchange128((volatile LONG64*)dst,
+		(LONG64)desired.tag, (LONG64)desired.ptr, (LONG64*)expected) ? 1 : 0;
+#else
+	LONGLONG  exp = *(LONGLONG*)expected;
+	LONGLONG  old = InterlockedCompareExchange64((volatile LONGLONG*)dst,
+		*(LONGLONG*)&desired, exp);
+	if (old == exp)
+		return 1;
+
+	*(LONGLONG*)expected = old;
+	return 0;
+#endif
+}
+
+/*VCvolatileдлȡͷ壬ָдԭӵ*/
+void elr_atomic_load_tagged(volatile elr_tagged_ptr* src, elr_tagged_ptr* val)
+{
+	val->ptr = src->ptr;
+	val->tag = src->tag;
+}
+
+void* elr_atomic_load_word(void* volatile* src)
+{
+	return *src;
+}
+
+void elr_atomic_store_word(void* volatile* dst, void* val)
+{
+	*dst = val;
+}
+
+int elr_atomic_load_int(volatile int* src)
+{
+	return *src;
+}
+
+void elr_atomic_store_int(volatile int* dst, int val)
+{
+	*dst = val;
+}
+
 /*
 ** ʼ壬0ʾʼʧ
 */
@@ -29,6 +121,11 @@ int  elr_mtx_init(elr_mtx *mtx)
 	return 1;
 }
 
+unsigned long elr_thread_self()
+{
+	return GetCurrentThreadId();
+}
+
 void elr_mtx_lock (elr_mtx *mtx)
 {
 	EnterCriticalSection(&mtx->_cs);
@@ -43,4 +140,259 @@ void elr_mtx_finalize(elr_mtx *mtx)
 {
 	DeleteCriticalSection(&mtx->_cs);
 }
-#endif
\ No newline at end of file
+
+/*
+** ʹ˳ֲ̾洢ص߳˳ʱ
+*/
+int   elr_tls_init(elr_tls_t *key, elr_tls_callback on_exit)
+{
+	*key = FlsAlloc(on_exit);
+	if (*key == FLS_OUT_OF_INDEXES)
+		return 0;
+
+	return 1;
+}
+
+void* elr_tls_get(elr_tls_t *key)
+{
+	return FlsGetValue(*key);
+}
+
+int   elr_tls_set(elr_tls_t *key, void* val)
+{
+	return FlsSetValue(*key, val) ? 1 : 0;
+}
+
+void  elr_tls_finalize(elr_tls_t *key)
+{
+	FlsFree(*key);
+}
+
+#elif defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+/*ȴ*/
+#define ELR_MTX_MAX_SPINS     100
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ELR_CPU_RELAX()       __builtin_ia32_pause()
+#elif defined(__aarch64__) || defined(__arm__)
+#define ELR_CPU_RELAX()       __asm__ __volatile__("yield")
+#else
+#define ELR_CPU_RELAX()       atomic_signal_fence(memory_order_seq_cst)
+#endif
+
+/*û壬ʱΪ0*/
+static int s_max_spins = -1;
+
+elr_counter_t elr_atomic_inc(elr_atomic_t* v)
+{
+	return atomic_fetch_add(v, 1) + 1;
+}
+
+elr_counter_t elr_atomic_dec(elr_atomic_t* v)
+{
+	return atomic_fetch_sub(v, 1) - 1;
+}
+
+elr_counter_t elr_atomic_add(elr_atomic_t* v, elr_counter_t n)
+{
+	return atomic_fetch_add(v, n) + n;
+}
+
+elr_counter_t elr_atomic_load(elr_atomic_t* v)
+{
+	return atomic_load_explicit(v, memory_order_relaxed);
+}
+
+elr_counter64_t elr_atomic_inc64(elr_atomic64_t* v)
+{
+	return atomic_fetch_add(v, 1) + 1;
+}
+
+elr_counter64_t elr_atomic_add64(elr_atomic64_t* v, elr_counter64_t n)
+{
+	return atomic_fetch_add(v, n) + n;
+}
+
+elr_counter64_t elr_atomic_load64(elr_atomic64_t* v)
+{
+	return atomic_load_explicit(v, memory_order_relaxed);
+}
+
+void* elr_atomic_load_ptr(elr_atomic_ptr* src)
+{
+	return atomic_load_explicit(src, memory_order_acquire);
+}
+
+void* elr_atomic_xchg_ptr(elr_atomic_ptr* dst, void* val)
+{
+	return atomic_exchange_explicit(dst, val, memory_order_acq_rel);
+}
+
+int elr_atomic_cas_ptr(elr_atomic_ptr* dst, void** expected, void* desired)
+{
+	return atomic_compare_exchange_weak_explicit(dst, expected, desired,
+		memory_order_release, memory_order_relaxed) ? 1 : 0;
+}
+
+int elr_atomic_cas_tagged(volatile elr_tagged_ptr* dst,
+	elr_tagged_ptr* expected,
+	elr_tagged_ptr desired)
+{
+#if defined(__GCC_HAVE_SYNC_COMPARE_AND_SWAP_16) && defined(__x86_64__)
+	unsigned __int128  exp = *(unsigned __int128*)expected;
+	unsigned __int128  old = __sync_val_compare_and_swap((volatile unsigned __int128*)dst,
+		exp, *(unsigned __int128*)&desired);
+	if (old == exp)
+		return 1;
+
+	*(unsigned __int128*)expected = old;
+	return 0;
+#else
+	/*֧˫ֱȽϽָʱlibatomicʵ*/
+	return __atomic_compare_exchange((elr_tagged_ptr*)dst, expected, &desired,
+		0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) ? 1 : 0;
+#endif
+}
+
+/*ͨ_Atomicͣgccԭڽд*/
+void elr_atomic_load_tagged(volatile elr_tagged_ptr* src, elr_tagged_ptr* val)
+{
+	val->ptr = __atomic_load_n(&src->ptr, __ATOMIC_ACQUIRE);
+	val->tag = __atomic_load_n(&src->tag, __ATOMIC_RELAXED);
+}
+
+void* elr_atomic_load_word(void* volatile* src)
+{
+	return __atomic_load_n(src, __ATOMIC_ACQUIRE);
+}
+
+void elr_atomic_store_word(void* volatile* dst, void* val)
+{
+	__atomic_store_n(dst, val, __ATOMIC_RELEASE);
+}
+
+int elr_atomic_load_int(volatile int* src)
+{
+	return __atomic_load_n(src, __ATOMIC_ACQUIRE);
+}
+
+void elr_atomic_store_int(volatile int* dst, int val)
+{
+	__atomic_store_n(dst, val, __ATOMIC_RELEASE);
+}
+
+/*
+** ʼ壬0ʾʼʧ
+*/
+int  elr_mtx_init(elr_mtx *mtx)
+{
+	if (s_max_spins < 0)
+		s_max_spins = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? ELR_MTX_MAX_SPINS : 0;
+
+	atomic_init(&mtx->_state, 0);
+	atomic_init(&mtx->_owner, 0);
+	mtx->_count = 0;
+	atomic_init(&mtx->_spins, 0);
+
+	return 1;
+}
+
+unsigned long elr_thread_self()
+{
+	return (unsigned long)pthread_self();
+}
+
+/*
+** ȴǽڻʱƽֵ
+** δ״̬Ϊ2futex˯ߣֱ̻߳ѡ
+*/
+void elr_mtx_lock (elr_mtx *mtx)
+{
+	unsigned long  self = (unsigned long)pthread_self();
+	int            state = 0;
+	int            spins = 0;
+	int            max_spins = 0;
+	int            avg_spins = 0;
+
+	if (atomic_load_explicit(&mtx->_owner, memory_order_relaxed) == self)
+	{
+		mtx->_count++;
+		return;
+	}
+
+	if (!atomic_compare_exchange_strong_explicit(&mtx->_state, &state, 1,
+		memory_order_acquire, memory_order_relaxed))
+	{
+		avg_spins = atomic_load_explicit(&mtx->_spins, memory_order_relaxed);
+		max_spins = avg_spins * 2 + 10;
+		if (max_spins > s_max_spins)
+			max_spins = s_max_spins;
+
+		for (spins = 0; spins < max_spins; spins++)
+		{
+			ELR_CPU_RELAX();
+			state = 0;
+			if (atomic_load_explicit(&mtx->_state, memory_order_relaxed) == 0
+				&& atomic_compare_exchange_weak_explicit(&mtx->_state, &state, 1,
+					memory_order_acquire, memory_order_relaxed))
+				break;
+		}
+		atomic_store_explicit(&mtx->_spins, avg_spins + (spins - avg_spins) / 8,
+			memory_order_relaxed);
+
+		if (spins == max_spins)
+		{
+			while (atomic_exchange_explicit(&mtx->_state, 2, memory_order_acquire) != 0)
+				syscall(SYS_futex, (int*)&mtx->_state, FUTEX_WAIT_PRIVATE, 2, NULL, NULL, 0);
+		}
+	}
+
+	atomic_store_explicit(&mtx->_owner, self, memory_order_relaxed);
+	mtx->_count = 1;
+}
+
+void elr_mtx_unlock(elr_mtx *mtx)
+{
+	if (--mtx->_count > 0)
+		return;
+
+	atomic_store_explicit(&mtx->_owner, 0, memory_order_relaxed);
+	if (atomic_fetch_sub_explicit(&mtx->_state, 1, memory_order_release) != 1)
+	{
+		atomic_store_explicit(&mtx->_state, 0, memory_order_release);
+		syscall(SYS_futex, (int*)&mtx->_state, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+	}
+}
+
+void elr_mtx_finalize(elr_mtx *mtx)
+{
+	(void)mtx;
+}
+
+/*
+** ʹpthreadֲ߳̾洢߳˳ʱ
+*/
+int   elr_tls_init(elr_tls_t *key, elr_tls_callback on_exit)
+{
+	return pthread_key_create(key, on_exit) == 0 ? 1 : 0;
+}
+
+void* elr_tls_get(elr_tls_t *key)
+{
+	return pthread_getspecific(*key);
+}
+
+int   elr_tls_set(elr_tls_t *key, void* val)
+{
+	return pthread_setspecific(*key, val) == 0 ? 1 : 0;
+}
+
+void  elr_tls_finalize(elr_tls_t *key)
+{
+	pthread_key_delete(*key);
+}
+#endif
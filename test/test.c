@@ -5,6 +5,13 @@
 #include "time.h"
 #include "cunit.h"
 
+#ifdef ELR_USE_THREAD
+#include "elr_mtx.h"
+#if defined(_WIN32)
+#include <process.h>
+#endif
+#endif // ELR_USE_THREAD
+
 unsigned long my_clock()
 {
 #ifdef _WIN64
@@ -28,6 +35,54 @@ int  test_alloc_callback();
 
 int  test_free_callback();
 
+int  test_calloc();
+
+int  test_tracking();
+
+int  test_cache_alloc();
+
+int  test_lockfree_alloc();
+
+int  test_lockfree_threads();
+
+int  test_batch_alloc();
+
+int  test_compact_alloc();
+
+int  test_arena_alloc();
+
+int  test_aligned_alloc();
+
+int  test_multi_alloc();
+
+int  test_large_alloc();
+
+int  test_realloc();
+
+int  test_huge_page_alloc();
+
+int  test_retention_trim();
+
+int  test_stats();
+
+int  test_stats_threads();
+
+int  test_latency();
+
+int  test_size_classes();
+
+int  test_suggest_classes();
+
+int  test_heap_sampling();
+
+int  test_owned_alloc();
+
+int  test_owned_remote_free();
+
+int  test_sharded_alloc();
+
+int  test_mpl_allocator();
+
 /* generate memory fragments */
 char *fragment_stack[100000];
 void make_fragments(int mem_size);
@@ -66,6 +121,30 @@ int main()
 	RUN_TEST_BOOLEAN(test_mem_alloc, "Allocate memory of the same size be declared.");
 	RUN_TEST_BOOLEAN(test_alloc_callback, "The memory is correctly changed by alloc callback.");
 	RUN_TEST_BOOLEAN(test_free_callback, "The memory is correctly changed by free callback.");
+	RUN_TEST_BOOLEAN(test_calloc, "Memory from calloc is zeroed after reuse, for small, big and large blocks.");
+	RUN_TEST_BOOLEAN(test_tracking, "Free callback runs on destroy only for pools tracking memory in use.");
+	RUN_TEST_BOOLEAN(test_cache_alloc, "Memory of a pool with thread cache is reused after freed.");
+	RUN_TEST_BOOLEAN(test_lockfree_alloc, "Memory of a lock-free pool is reused after freed.");
+	RUN_TEST_BOOLEAN(test_lockfree_threads, "Memory of a lock-free pool is never handed to two threads at once.");
+	RUN_TEST_BOOLEAN(test_owned_alloc, "Memory of a pool owned by a thread is reused after freed.");
+	RUN_TEST_BOOLEAN(test_owned_remote_free, "Memory of an owned pool freed by another thread is taken back by stats and trim.");
+	RUN_TEST_BOOLEAN(test_sharded_alloc, "Memory of a pool sharded by CPU is reused after freed.");
+	RUN_TEST_BOOLEAN(test_batch_alloc, "Allocate and free memory in batch.");
+	RUN_TEST_BOOLEAN(test_aligned_alloc, "Memory of aligned pools is aligned as declared.");
+	RUN_TEST_BOOLEAN(test_compact_alloc, "Memory of a compact pool is packed without header and reused after freed.");
+	RUN_TEST_BOOLEAN(test_arena_alloc, "Memory of an arena pool is carved in order and released by reset and rewind.");
+	RUN_TEST_BOOLEAN(test_multi_alloc, "Allocate memory of any size from the smallest pool which can hold it.");
+	RUN_TEST_BOOLEAN(test_large_alloc, "Large memory blocks are mapped directly and reused after freed.");
+	RUN_TEST_BOOLEAN(test_realloc, "Memory is resized in place within a size class and keeps its content across classes.");
+	RUN_TEST_BOOLEAN(test_huge_page_alloc, "Memory of a pool backed by huge pages is usable.");
+	RUN_TEST_BOOLEAN(test_retention_trim, "Empty nodes are released by retention policy and trim.");
+	RUN_TEST_BOOLEAN(test_stats, "Statistics of pools are counted and summed up along the tree.");
+	RUN_TEST_BOOLEAN(test_stats_threads, "Statistics and latencies of the whole tree are taken while other threads create and destroy pools.");
+	RUN_TEST_BOOLEAN(test_latency, "Latency percentiles of pools are recorded when histograms are compiled in.");
+	RUN_TEST_BOOLEAN(test_size_classes, "Size classes are generated geometrically and their fragmentation is reported.");
+	RUN_TEST_BOOLEAN(test_suggest_classes, "Size classes suggested from recorded sizes are saved and loaded.");
+	RUN_TEST_BOOLEAN(test_heap_sampling, "Sampled memory blocks in use are written as a heap profile.");
+	RUN_TEST_BOOLEAN(test_mpl_allocator, "Memory from the C++ allocator is aligned for its type and usable by containers.");
 
 	getchar();
 
@@ -137,6 +216,13 @@ void on_free(void* mem)
 	memset(mem, 0, 256);
 }
 
+int free_calls = 0;
+
+void on_count_free(void* mem)
+{
+	free_calls++;
+}
+
 int test_alloc_callback()
 {
 	int ret = 0;
@@ -167,6 +253,1125 @@ int test_free_callback()
 }
 
 
+int is_zero(const char* mem, size_t size)
+{
+	size_t i = 0;
+
+	for (i = 0; i < size && mem[i] == 0; i++);
+	return i == size;
+}
+
+int test_calloc()
+{
+	int ret = 1;
+	char* p = NULL;
+	size_t sizes[3] = { 100, 200000, 4000000 };
+	size_t obj_size[2] = { 64, 256 };
+	elr_mpl_t pool = elr_mpl_create(NULL, 100, on_malloc, NULL);
+	elr_mpl_t multi = elr_mpl_create_multi(NULL, 2, obj_size, NULL, NULL);
+	int i = 0;
+
+	p = (char*)elr_mpl_alloc(&pool);
+	memset(p, 0xff, 100);
+	elr_mpl_free(p);
+	/*alloc callback runs after zeroing*/
+	p = (char*)elr_mpl_calloc(&pool);
+	if (strcmp(p, "hello world") != 0 || !is_zero(p + 12, 88))
+		ret = 0;
+	elr_mpl_free(p);
+
+	for (i = 0; i < 3; i++)
+	{
+		p = (char*)elr_mpl_calloc_multi(&multi, sizes[i]);
+		if (p == NULL || !is_zero(p, sizes[i]))
+			ret = 0;
+		else
+			memset(p, 0xff, sizes[i]);
+		elr_mpl_free(p);
+		p = (char*)elr_mpl_calloc_multi(&multi, sizes[i] - 3);
+		if (p == NULL || !is_zero(p, sizes[i] - 3))
+			ret = 0;
+		elr_mpl_free(p);
+	}
+
+	elr_mpl_destroy(&multi);
+	elr_mpl_destroy(&pool);
+	return ret;
+}
+
+int test_tracking()
+{
+	int ret = 1;
+	void* p = NULL;
+	elr_mpl_t tracked = elr_mpl_create(NULL, 64, NULL, on_count_free);
+	elr_mpl_t untracked = elr_mpl_create(NULL, 64, NULL, on_count_free);
+
+	/*memory in use is freed by destroy*/
+	free_calls = 0;
+	p = elr_mpl_alloc(&tracked);
+	if (p == NULL)
+		ret = 0;
+	elr_mpl_free(elr_mpl_alloc(&tracked));
+	elr_mpl_destroy(&tracked);
+	if (free_calls != 2)
+		ret = 0;
+
+	free_calls = 0;
+	if (elr_mpl_set_tracking(&untracked, 0) == 0)
+		ret = 0;
+	p = elr_mpl_alloc(&untracked);
+	if (p == NULL)
+		ret = 0;
+	elr_mpl_free(elr_mpl_alloc(&untracked));
+	/*can not change while memory is in use*/
+	if (elr_mpl_set_tracking(&untracked, 1) != 0)
+		ret = 0;
+	elr_mpl_destroy(&untracked);
+	if (free_calls != 1)
+		ret = 0;
+
+	return ret;
+}
+
+#ifdef ELR_USE_THREAD
+/* a function run on its own thread by run_threads */
+typedef struct __thread_job
+{
+	void (*func)(void*);
+	void* arg;
+#if defined(_WIN32)
+	HANDLE handle;
+#else
+	pthread_t handle;
+#endif
+}
+thread_job;
+
+#if defined(_WIN32)
+unsigned __stdcall thread_main(void* arg)
+{
+	((thread_job*)arg)->func(((thread_job*)arg)->arg);
+	return 0;
+}
+#else
+void* thread_main(void* arg)
+{
+	((thread_job*)arg)->func(((thread_job*)arg)->arg);
+	return NULL;
+}
+#endif
+
+/* run func(args[i]) on count threads at once and wait for all of them */
+int run_threads(int count, void (*func)(void*), void** args)
+{
+	int i = 0;
+	int started = 0;
+	thread_job jobs[8];
+
+	for (i = 0; i < count && i < 8; i++)
+	{
+		jobs[i].func = func;
+		jobs[i].arg = args[i];
+#if defined(_WIN32)
+		jobs[i].handle = (HANDLE)_beginthreadex(NULL, 0, thread_main, &jobs[i], 0, NULL);
+		if (jobs[i].handle == 0)
+			break;
+#else
+		if (pthread_create(&jobs[i].handle, NULL, thread_main, &jobs[i]) != 0)
+			break;
+#endif
+	}
+	started = i;
+
+	for (i = 0; i < started; i++)
+	{
+#if defined(_WIN32)
+		WaitForSingleObject(jobs[i].handle, INFINITE);
+		CloseHandle(jobs[i].handle);
+#else
+		pthread_join(jobs[i].handle, NULL);
+#endif
+	}
+
+	return started == count;
+}
+#endif // ELR_USE_THREAD
+
+int test_cache_alloc()
+{
+	int ret = 1;
+	int i = 0;
+	int j = 0;
+	void* q = NULL;
+	void* p[64] = { NULL };
+	elr_mpl_t pool = elr_mpl_create_cached(NULL, 256, 16, NULL, NULL);
+
+	for (i = 0; i < 64; i++)
+	{
+		p[i] = elr_mpl_alloc(&pool);
+		if (p[i] == NULL || elr_mpl_size(p[i]) != 256)
+			ret = 0;
+	}
+
+	for (i = 0; i < 64; i++)
+		elr_mpl_free(p[i]);
+
+	/*freed blocks are reused*/
+	q = elr_mpl_alloc(&pool);
+	for (j = 0; j < 64 && p[j] != q; j++);
+	if (j == 64)
+		ret = 0;
+
+	elr_mpl_destroy(&pool);
+	return ret && (elr_mpl_avail(&pool) == 0);
+}
+
+int test_lockfree_alloc()
+{
+	int ret = 1;
+	int i = 0;
+	int j = 0;
+	void* q = NULL;
+	void* p[64] = { NULL };
+	elr_mpl_t pool = elr_mpl_create_lockfree(NULL, 128, NULL, NULL);
+
+	for (i = 0; i < 64; i++)
+	{
+		p[i] = elr_mpl_alloc(&pool);
+		if (p[i] == NULL || elr_mpl_size(p[i]) != 128)
+			ret = 0;
+		else
+			memset(p[i], 0, 128);
+	}
+
+	for (i = 0; i < 64; i++)
+		elr_mpl_free(p[i]);
+
+	/*freed blocks are reused*/
+	q = elr_mpl_alloc(&pool);
+	for (j = 0; j < 64 && p[j] != q; j++);
+	if (j == 64)
+		ret = 0;
+	elr_mpl_free(q);
+
+	elr_mpl_destroy(&pool);
+	return ret && (elr_mpl_avail(&pool) == 0);
+}
+
+#ifdef ELR_USE_THREAD
+#define CROSS_FREE_THREADS 4
+#define CROSS_FREE_BATCH   32
+#define CROSS_FREE_ROUNDS  2000
+
+/* blocks allocated on one thread are left for another thread to free */
+typedef struct __cross_free_job
+{
+	elr_mpl_ht pool;
+	elr_mtx* mutex;
+	void** exchange;
+	int* exchange_count;
+	int id;
+	int failed;
+}
+cross_free_job;
+
+void cross_free(void* arg)
+{
+	int i = 0;
+	int k = 0;
+	int round = 0;
+	int count = 0;
+	int stamp = 0;
+	void* mem[CROSS_FREE_BATCH] = { NULL };
+	void* taken[CROSS_FREE_BATCH] = { NULL };
+	cross_free_job* job = (cross_free_job*)arg;
+
+	for (round = 0; round < CROSS_FREE_ROUNDS; round++)
+	{
+		/*a block handed out twice gets stamped by two threads*/
+		stamp = job->id * CROSS_FREE_ROUNDS + round;
+		for (i = 0; i < CROSS_FREE_BATCH; i++)
+		{
+			mem[i] = elr_mpl_alloc(job->pool);
+			if (mem[i] == NULL)
+			{
+				job->failed = 1;
+				return;
+			}
+			for (k = 0; k < 4; k++)
+				((int*)mem[i])[k] = stamp;
+		}
+		for (i = 0; i < CROSS_FREE_BATCH; i++)
+		{
+			for (k = 0; k < 4; k++)
+			{
+				if (((int*)mem[i])[k] != stamp)
+					job->failed = 1;
+			}
+		}
+
+		/*take the batch another thread left and leave this one*/
+		elr_mtx_lock(job->mutex);
+		count = *job->exchange_count;
+		for (i = 0; i < count; i++)
+			taken[i] = job->exchange[i];
+		for (i = 0; i < CROSS_FREE_BATCH; i++)
+			job->exchange[i] = mem[i];
+		*job->exchange_count = CROSS_FREE_BATCH;
+		elr_mtx_unlock(job->mutex);
+
+		for (i = 0; i < count; i++)
+			elr_mpl_free(taken[i]);
+	}
+}
+#endif // ELR_USE_THREAD
+
+int test_lockfree_threads()
+{
+#ifdef ELR_USE_THREAD
+	int ret = 1;
+	int i = 0;
+	int exchange_count = 0;
+	void* exchange[CROSS_FREE_BATCH] = { NULL };
+	void* args[CROSS_FREE_THREADS];
+	cross_free_job jobs[CROSS_FREE_THREADS];
+	elr_mtx mutex;
+	elr_mpl_stats_t stats;
+	elr_mpl_t pool = elr_mpl_create_lockfree(NULL, 64, NULL, NULL);
+
+	if (elr_mtx_init(&mutex) == 0)
+		return 0;
+	for (i = 0; i < CROSS_FREE_THREADS; i++)
+	{
+		jobs[i].pool = &pool;
+		jobs[i].mutex = &mutex;
+		jobs[i].exchange = exchange;
+		jobs[i].exchange_count = &exchange_count;
+		jobs[i].id = i;
+		jobs[i].failed = 0;
+		args[i] = &jobs[i];
+	}
+
+	if (run_threads(CROSS_FREE_THREADS, cross_free, args) == 0)
+		ret = 0;
+	for (i = 0; i < CROSS_FREE_THREADS; i++)
+	{
+		if (jobs[i].failed != 0)
+			ret = 0;
+	}
+	for (i = 0; i < exchange_count; i++)
+		elr_mpl_free(exchange[i]);
+	elr_mtx_finalize(&mutex);
+
+	elr_mpl_stats(&pool, &stats, 0);
+	if (stats.slice_count != 0 || stats.alloc_count != stats.free_count
+		|| stats.alloc_count != CROSS_FREE_THREADS * CROSS_FREE_ROUNDS * CROSS_FREE_BATCH)
+		ret = 0;
+
+	elr_mpl_destroy(&pool);
+	return ret;
+#else
+	return 1;
+#endif // ELR_USE_THREAD
+}
+
+int test_owned_alloc()
+{
+	int ret = 1;
+	int i = 0;
+	int j = 0;
+	void* q = NULL;
+	void* p[64] = { NULL };
+	elr_mpl_stats_t stats;
+	elr_mpl_t pool = elr_mpl_create_owned(NULL, 128, on_malloc, NULL);
+
+	for (i = 0; i < 64; i++)
+	{
+		p[i] = elr_mpl_alloc(&pool);
+		if (p[i] == NULL || elr_mpl_size(p[i]) != 128
+			|| strcmp((char*)p[i], "hello world") != 0)
+			ret = 0;
+	}
+
+	elr_mpl_free_batch(p, 32);
+	for (i = 32; i < 64; i++)
+		elr_mpl_free(p[i]);
+
+	/*freed blocks are reused*/
+	q = elr_mpl_alloc(&pool);
+	for (j = 0; j < 64 && p[j] != q; j++);
+	if (j == 64)
+		ret = 0;
+	elr_mpl_free(q);
+
+	elr_mpl_stats(&pool, &stats, 0);
+	if (stats.slice_count != 0 || stats.alloc_count != 65 || stats.free_count != 65)
+		ret = 0;
+
+	elr_mpl_destroy(&pool);
+	return ret && (elr_mpl_avail(&pool) == 0);
+}
+
+#ifdef ELR_USE_THREAD
+/* memory blocks freed on another thread */
+typedef struct __free_job
+{
+	void** mem;
+	int count;
+}
+free_job;
+
+void free_blocks(void* arg)
+{
+	int i = 0;
+	free_job* job = (free_job*)arg;
+
+	for (i = 0; i < job->count; i++)
+		elr_mpl_free(job->mem[i]);
+}
+
+/* the owner keeps allocating while another thread frees the blocks */
+void alloc_free_remote(elr_mpl_ht pool, void** mem, int count, int* ret)
+{
+	int i = 0;
+	void* q = NULL;
+	free_job job;
+	void* args[1];
+
+	job.mem = mem;
+	job.count = count;
+	args[0] = &job;
+	for (i = 0; i < count; i++)
+	{
+		if ((mem[i] = elr_mpl_alloc(pool)) == NULL)
+			*ret = 0;
+	}
+	for (i = 0; i < 1000; i++)
+	{
+		q = elr_mpl_alloc(pool);
+		if (q == NULL)
+			*ret = 0;
+		elr_mpl_free(q);
+	}
+	if (run_threads(1, free_blocks, args) == 0)
+		*ret = 0;
+}
+#endif // ELR_USE_THREAD
+
+int test_owned_remote_free()
+{
+#ifdef ELR_USE_THREAD
+	int ret = 1;
+	void** p = (void**)malloc(4096 * sizeof(void*));
+	elr_mpl_stats_t stats;
+	elr_mpl_t pool = elr_mpl_create_owned(NULL, 128, NULL, NULL);
+
+	/*stats takes back blocks freed by other threads*/
+	alloc_free_remote(&pool, p, 4096, &ret);
+	elr_mpl_stats(&pool, &stats, 0);
+	if (stats.slice_count != 0 || stats.alloc_count != 5096 || stats.free_count != 5096)
+		ret = 0;
+
+	/*so does trim, and the nodes of those blocks are released*/
+	alloc_free_remote(&pool, p, 4096, &ret);
+	if (elr_mpl_trim(&pool, 0) == 0)
+		ret = 0;
+	elr_mpl_stats(&pool, &stats, 0);
+	if (stats.slice_count != 0 || stats.node_count != 0)
+		ret = 0;
+
+	free(p);
+	elr_mpl_destroy(&pool);
+	return ret;
+#else
+	return 1;
+#endif // ELR_USE_THREAD
+}
+
+int test_sharded_alloc()
+{
+	int ret = 1;
+	int i = 0;
+	int j = 0;
+	void* q = NULL;
+	void* p[200] = { NULL };
+	elr_mpl_stats_t stats;
+	elr_mpl_t pool = elr_mpl_create_sharded(NULL, 256, on_malloc, NULL);
+
+	for (i = 0; i < 200; i++)
+	{
+		p[i] = elr_mpl_alloc(&pool);
+		if (p[i] == NULL || elr_mpl_size(p[i]) != 256
+			|| strcmp((char*)p[i], "hello world") != 0)
+			ret = 0;
+	}
+
+	elr_mpl_stats(&pool, &stats, 0);
+	if (stats.slice_count != 200 || stats.alloc_count != 200)
+		ret = 0;
+
+	elr_mpl_free_batch(p, 100);
+	for (i = 100; i < 200; i++)
+		elr_mpl_free(p[i]);
+
+	/*freed blocks are reused*/
+	q = elr_mpl_alloc(&pool);
+	for (j = 0; j < 200 && p[j] != q; j++);
+	if (j == 200)
+		ret = 0;
+	elr_mpl_free(q);
+
+	elr_mpl_stats(&pool, &stats, 0);
+	if (stats.slice_count != 0 || stats.free_count != 201)
+		ret = 0;
+
+	elr_mpl_destroy(&pool);
+	return ret && (elr_mpl_avail(&pool) == 0);
+}
+
+int test_batch_alloc()
+{
+	int ret = 1;
+	size_t i = 0;
+	size_t n = 0;
+	void* p[200] = { NULL };
+	elr_mpl_t pool = elr_mpl_create(NULL, 256, on_malloc, NULL);
+
+	n = elr_mpl_alloc_batch(&pool, 200, p);
+	if (n != 200)
+		ret = 0;
+
+	for (i = 0; i < n; i++)
+	{
+		if (elr_mpl_size(p[i]) != 256 || strcmp((char*)p[i], "hello world") != 0)
+			ret = 0;
+		memset(p[i], 0, 256);
+	}
+
+	elr_mpl_free_batch(p, n / 2);
+	elr_mpl_free_batch(p + n / 2, n - n / 2);
+
+	n = elr_mpl_alloc_batch(&pool, 200, p);
+	if (n != 200)
+		ret = 0;
+	elr_mpl_free_batch(p, n);
+
+	elr_mpl_destroy(&pool);
+	return ret;
+}
+
+int test_compact_alloc()
+{
+	int ret = 1;
+	int i = 0;
+	int j = 0;
+	void* q = NULL;
+	void* p[2000] = { NULL };
+	elr_mpl_t pool = elr_mpl_create_compact(NULL, 64, on_malloc, NULL);
+	elr_mpl_t normal = elr_mpl_create(NULL, 64, NULL, NULL);
+
+	for (i = 0; i < 2000; i++)
+	{
+		p[i] = elr_mpl_alloc(&pool);
+		if (p[i] == NULL || elr_mpl_size(p[i]) != 64
+			|| strcmp((char*)p[i], "hello world") != 0)
+			ret = 0;
+	}
+
+	/*blocks are adjacent*/
+	if ((char*)p[1] - (char*)p[0] != 64)
+		ret = 0;
+
+	for (i = 0; i < 2000; i++)
+		elr_mpl_free(p[i]);
+
+	/*freed blocks are reused*/
+	q = elr_mpl_alloc(&pool);
+	for (j = 0; j < 2000 && p[j] != q; j++);
+	if (j == 2000)
+		ret = 0;
+	elr_mpl_free(q);
+
+	/*blocks of ordinary pools are still freed by header*/
+	q = elr_mpl_alloc(&normal);
+	if (elr_mpl_size(q) != 64)
+		ret = 0;
+	elr_mpl_free(q);
+
+	elr_mpl_destroy(&normal);
+	elr_mpl_destroy(&pool);
+	return ret && (elr_mpl_avail(&pool) == 0);
+}
+
+int test_arena_alloc()
+{
+	int ret = 1;
+	int i = 0;
+	char* p = NULL;
+	char* q = NULL;
+	char* r = NULL;
+	elr_mpl_mark_t outer;
+	elr_mpl_mark_t inner;
+	elr_mpl_stats_t stats;
+	elr_mpl_t pool = elr_mpl_create_arena(NULL, 24);
+
+	p = (char*)elr_mpl_alloc(&pool);
+	q = (char*)elr_mpl_alloc(&pool);
+	/*blocks are adjacent and aligned*/
+	if (p == NULL || q - p != 32 || ((size_t)p & 15) != 0)
+		ret = 0;
+
+	elr_mpl_mark(&pool, &outer);
+	r = (char*)elr_mpl_alloc_arena(&pool, 100);
+	elr_mpl_mark(&pool, &inner);
+	/*more than a node*/
+	for (i = 0; i < 100; i++)
+	{
+		if (elr_mpl_alloc_arena(&pool, 1000) == NULL)
+			ret = 0;
+	}
+	if (elr_mpl_alloc_arena(&pool, 200000) == NULL)
+		ret = 0;
+
+	elr_mpl_rewind(&pool, &inner);
+	if ((char*)elr_mpl_alloc_arena(&pool, 8) != r + 112)
+		ret = 0;
+	elr_mpl_rewind(&pool, &outer);
+	if ((char*)elr_mpl_alloc_arena(&pool, 8) != r)
+		ret = 0;
+
+	elr_mpl_stats(&pool, &stats, 0);
+	if (stats.slice_count != 3 || stats.node_count != 3)
+		ret = 0;
+
+	/*nodes are kept after reset*/
+	elr_mpl_reset(&pool);
+	if ((char*)elr_mpl_alloc(&pool) != p)
+		ret = 0;
+	elr_mpl_trim(&pool, 0);
+	elr_mpl_stats(&pool, &stats, 0);
+	if (stats.slice_count != 1 || stats.node_count != 1)
+		ret = 0;
+
+	elr_mpl_destroy(&pool);
+	return ret && (elr_mpl_avail(&pool) == 0);
+}
+
+int test_aligned_alloc()
+{
+	int ret = 1;
+	int i = 0;
+	void* p[100] = { NULL };
+	size_t obj_size[3] = { 24, 100, 1000 };
+	elr_mpl_t pool = elr_mpl_create_aligned(NULL, 100, 64, NULL, NULL);
+	elr_mpl_t multi = elr_mpl_create_multi_aligned(NULL, 3, obj_size, 32, NULL, NULL);
+
+	for (i = 0; i < 100; i++)
+	{
+		p[i] = elr_mpl_alloc(&pool);
+		if (p[i] == NULL || ((size_t)p[i] & 63) != 0 || elr_mpl_size(p[i]) != 100)
+			ret = 0;
+		else
+			memset(p[i], 0, 100);
+	}
+	for (i = 0; i < 100; i++)
+		elr_mpl_free(p[i]);
+
+	/*sizes out of range of obj_size included*/
+	for (i = 0; i < 100; i++)
+	{
+		p[i] = elr_mpl_alloc_multi(&multi, 1 + i * 50);
+		if (p[i] == NULL || ((size_t)p[i] & 31) != 0 || elr_mpl_size(p[i]) < (size_t)(1 + i * 50))
+			ret = 0;
+		else
+			memset(p[i], 0, 1 + i * 50);
+	}
+	for (i = 0; i < 100; i++)
+		elr_mpl_free(p[i]);
+
+	elr_mpl_destroy(&multi);
+	elr_mpl_destroy(&pool);
+	return ret;
+}
+
+int test_multi_alloc()
+{
+	int ret = 1;
+	size_t i = 0;
+	void* p = NULL;
+	void* q = NULL;
+	size_t obj_size[4] = { 16, 100, 256, 1000 };
+	elr_mpl_t multi = elr_mpl_create_multi(NULL, 4, obj_size, NULL, NULL);
+
+	for (i = 1; i <= 1000; i++)
+	{
+		p = elr_mpl_alloc_multi(&multi, i);
+		if (p == NULL || elr_mpl_size(p) != (i <= 16 ? 16 : i <= 100 ? 100 : i <= 256 ? 256 : 1000))
+			ret = 0;
+		elr_mpl_free(p);
+	}
+
+	/*sizes out of range are rounded up to 1KB, and the same pool is reused*/
+	for (i = 1001; i <= 10000; i += 7)
+	{
+		p = elr_mpl_alloc_multi(&multi, i);
+		if (p == NULL || elr_mpl_size(p) != (i + 1023) / 1024 * 1024)
+			ret = 0;
+		q = elr_mpl_alloc_multi(&multi, (i + 1023) / 1024 * 1024);
+		if (q == NULL || elr_mpl_size(q) != elr_mpl_size(p))
+			ret = 0;
+		elr_mpl_free(q);
+		elr_mpl_free(p);
+	}
+
+	elr_mpl_destroy(&multi);
+	return ret && (elr_mpl_avail(&multi) == 0);
+}
+
+int test_large_alloc()
+{
+	int ret = 1;
+	int i = 0;
+	void* p = NULL;
+	void* q = NULL;
+	size_t obj_size[2] = { 64, 256 };
+	elr_mpl_t multi = elr_mpl_create_multi(NULL, 2, obj_size, NULL, NULL);
+
+	for (i = 0; i < 10; i++)
+	{
+		p = elr_mpl_alloc_multi(&multi, 4000000);
+		if (p == NULL || elr_mpl_size(p) < 4000000)
+			ret = 0;
+		else
+			memset(p, 0, 4000000);
+		/*freed mapping is reused*/
+		if (q != NULL && p != q)
+			ret = 0;
+		q = p;
+		elr_mpl_free(p);
+	}
+
+	p = elr_mpl_alloc_multi(&multi, 40000);
+	if (p == NULL || elr_mpl_size(p) < 40000)
+		ret = 0;
+	elr_mpl_free(p);
+
+	/*below the threshold memory comes from 1KB rounded pools*/
+	elr_mpl_set_large_size(&multi, 0);
+	p = elr_mpl_alloc_multi(&multi, 40000);
+	if (p == NULL || elr_mpl_size(p) != 40960)
+		ret = 0;
+	elr_mpl_free(p);
+
+	elr_mpl_destroy(&multi);
+	return ret;
+}
+
+int test_realloc()
+{
+	int ret = 1;
+	char* p = NULL;
+	char* q = NULL;
+	size_t obj_size[2] = { 64, 256 };
+	elr_mpl_t multi = elr_mpl_create_multi(NULL, 2, obj_size, NULL, NULL);
+
+	p = (char*)elr_mpl_realloc_multi(&multi, NULL, 50);
+	strcpy(p, "hello world");
+	/*same size class*/
+	if (elr_mpl_realloc_multi(&multi, p, 60) != p)
+		ret = 0;
+	q = (char*)elr_mpl_realloc_multi(&multi, p, 200);
+	if (q == NULL || elr_mpl_size(q) != 256 || strcmp(q, "hello world") != 0)
+		ret = 0;
+
+	/*large memory blocks keep their pages*/
+	p = (char*)elr_mpl_realloc_multi(&multi, q, 4000000);
+	if (p == NULL || strcmp(p, "hello world") != 0)
+		ret = 0;
+	p[3999999] = 'x';
+	p = (char*)elr_mpl_realloc_multi(&multi, p, 20000000);
+	if (p == NULL || elr_mpl_size(p) < 20000000
+		|| strcmp(p, "hello world") != 0 || p[3999999] != 'x')
+		ret = 0;
+	p[19999999] = 'y';
+
+	/*shrunk large memory blocks give back their surplus*/
+	p[999999] = 'z';
+	p = (char*)elr_mpl_realloc_multi(&multi, p, 1000000);
+	if (p == NULL || elr_mpl_size(p) < 1000000 || elr_mpl_size(p) >= 2000000
+		|| strcmp(p, "hello world") != 0 || p[999999] != 'z')
+		ret = 0;
+	/*and move to a size class below the large threshold*/
+	p = (char*)elr_mpl_realloc_multi(&multi, p, 100);
+	if (p == NULL || elr_mpl_size(p) != 256 || strcmp(p, "hello world") != 0)
+		ret = 0;
+
+	if (elr_mpl_realloc_multi(&multi, p, 0) != NULL)
+		ret = 0;
+
+	elr_mpl_destroy(&multi);
+	return ret;
+}
+
+int test_huge_page_alloc()
+{
+	int ret = 1;
+	int i = 0;
+	void* p[1000] = { NULL };
+	elr_mpl_t pool = elr_mpl_create(NULL, 4000, NULL, NULL);
+
+	if (elr_mpl_set_huge_page(&pool, 1) == 0)
+		ret = 0;
+
+	for (i = 0; i < 1000; i++)
+	{
+		p[i] = elr_mpl_alloc(&pool);
+		if (p[i] == NULL || elr_mpl_size(p[i]) != 4000)
+			ret = 0;
+		else
+			memset(p[i], 0, 4000);
+	}
+
+	/*too late to change once nodes exist*/
+	if (elr_mpl_set_huge_page(&pool, 0) != 0)
+		ret = 0;
+
+	for (i = 0; i < 1000; i++)
+		elr_mpl_free(p[i]);
+
+	elr_mpl_destroy(&pool);
+	return ret;
+}
+
+int test_retention_trim()
+{
+	int ret = 1;
+	int i = 0;
+	void* p[1000] = { NULL };
+	elr_mpl_t pool = elr_mpl_create(NULL, 1000, NULL, NULL);
+	elr_mpl_t child = elr_mpl_create(&pool, 1000, NULL, NULL);
+
+	for (i = 0; i < 1000; i++)
+		p[i] = elr_mpl_alloc(i % 2 == 0 ? &pool : &child);
+	for (i = 0; i < 1000; i++)
+		elr_mpl_free(p[i]);
+
+	if (elr_mpl_trim(&pool, 0) == 0)
+		ret = 0;
+	if (elr_mpl_trim(&pool, 0) != 0)
+		ret = 0;
+	if (elr_mpl_trim(&pool, 1) == 0)
+		ret = 0;
+
+	/*keep one empty node at most*/
+	elr_mpl_set_retention(&pool, 0, 1);
+	for (i = 0; i < 1000; i++)
+		p[i] = elr_mpl_alloc(&pool);
+	for (i = 0; i < 1000; i++)
+		elr_mpl_free(p[i]);
+	if (elr_mpl_trim(&pool, 0) > 100000)
+		ret = 0;
+
+	elr_mpl_destroy(&pool);
+	return ret;
+}
+
+int test_stats()
+{
+	int ret = 1;
+	int i = 0;
+	void* p[100] = { NULL };
+	elr_mpl_stats_t stats;
+	elr_mpl_t pool = elr_mpl_create(NULL, 100, NULL, NULL);
+	elr_mpl_t child = elr_mpl_create(&pool, 200, NULL, NULL);
+
+	for (i = 0; i < 100; i++)
+		p[i] = elr_mpl_alloc(i < 60 ? &pool : &child);
+	for (i = 0; i < 30; i++)
+		elr_mpl_free(p[i]);
+
+	elr_mpl_stats(&pool, &stats, 0);
+	if (stats.pool_count != 1 || stats.slice_count != 30 || stats.peak_slice_count != 60
+		|| stats.alloc_count != 60 || stats.free_count != 30
+		|| stats.requested_size != 3000 || stats.node_count != stats.node_alloc_count
+		|| stats.node_count == 0 || stats.reserved_size < 6000)
+		ret = 0;
+
+	elr_mpl_stats(&pool, &stats, 1);
+	if (stats.pool_count != 2 || stats.slice_count != 70 || stats.alloc_count != 100
+		|| stats.requested_size != 3000 + 40 * 200)
+		ret = 0;
+
+	for (i = 30; i < 100; i++)
+		elr_mpl_free(p[i]);
+	elr_mpl_stats(&pool, &stats, 1);
+	if (stats.slice_count != 0 || stats.free_count != 100)
+		ret = 0;
+
+	elr_mpl_destroy(&pool);
+	return ret;
+}
+
+#ifdef ELR_USE_THREAD
+#define TREE_WALK_ROUNDS 200
+
+/* one thread walks the whole tree while the other changes it */
+typedef struct __tree_walk_job
+{
+	elr_atomic_t* done;
+	int id;
+	int failed;
+}
+tree_walk_job;
+
+void tree_walk(void* arg)
+{
+	int i = 0;
+	int k = 0;
+	void* p = NULL;
+	size_t obj_size[2] = { 64, 128 };
+	elr_mpl_stats_t stats;
+	elr_mpl_t pool = ELR_MPL_INITIALIZER;
+	tree_walk_job* job = (tree_walk_job*)arg;
+
+	if (job->id != 0)
+	{
+		while (elr_atomic_load(job->done) == 0)
+		{
+			elr_mpl_stats(NULL, &stats, 1);
+			if (stats.pool_count == 0)
+				job->failed = 1;
+			if (elr_mpl_latency(NULL, ELR_MPL_LATENCY_ALLOC, 99, 1) < 0)
+				job->failed = 1;
+		}
+		return;
+	}
+
+	/*over-range pools are created under the lock of the multi pool*/
+	for (i = 0; i < TREE_WALK_ROUNDS; i++)
+	{
+		pool = elr_mpl_create_multi_sync(NULL, 2, obj_size, NULL, NULL);
+		for (k = 0; k < 28; k++)
+		{
+			p = elr_mpl_alloc_multi(&pool, 3000 + k * 1024);
+			if (p == NULL)
+				job->failed = 1;
+			elr_mpl_free(p);
+		}
+		elr_mpl_destroy(&pool);
+	}
+	elr_atomic_inc(job->done);
+}
+#endif // ELR_USE_THREAD
+
+int test_stats_threads()
+{
+#ifdef ELR_USE_THREAD
+	int ret = 1;
+	int i = 0;
+	elr_atomic_t done = ELR_ATOMIC_ZERO;
+	void* args[2];
+	tree_walk_job jobs[2];
+
+	for (i = 0; i < 2; i++)
+	{
+		jobs[i].done = &done;
+		jobs[i].id = i;
+		jobs[i].failed = 0;
+		args[i] = &jobs[i];
+	}
+
+	if (run_threads(2, tree_walk, args) == 0)
+		ret = 0;
+	if (jobs[0].failed != 0 || jobs[1].failed != 0)
+		ret = 0;
+
+	return ret;
+#else
+	return 1;
+#endif // ELR_USE_THREAD
+}
+
+int test_latency()
+{
+	int ret = 1;
+	int i = 0;
+	void* p[100] = { NULL };
+	double p50 = 0;
+	double p99 = 0;
+	elr_mpl_t pool = elr_mpl_create(NULL, 100, NULL, NULL);
+
+	for (i = 0; i < 100; i++)
+		p[i] = elr_mpl_alloc(&pool);
+	for (i = 0; i < 100; i++)
+		elr_mpl_free(p[i]);
+
+	p50 = elr_mpl_latency(&pool, ELR_MPL_LATENCY_ALLOC, 50, 0);
+	p99 = elr_mpl_latency(&pool, ELR_MPL_LATENCY_ALLOC, 99, 0);
+#ifdef ELR_USE_HISTOGRAM
+	if (p50 <= 0 || p99 < p50
+		|| elr_mpl_latency(&pool, ELR_MPL_LATENCY_FREE, 99, 0) <= 0
+		|| elr_mpl_latency(&pool, ELR_MPL_LATENCY_REFILL, 100, 0) <= 0)
+		ret = 0;
+
+	elr_mpl_latency_reset(&pool, 0);
+	if (elr_mpl_latency(&pool, ELR_MPL_LATENCY_ALLOC, 99, 0) != 0)
+		ret = 0;
+#else
+	if (p50 != 0 || p99 != 0)
+		ret = 0;
+#endif
+
+	elr_mpl_destroy(&pool);
+	return ret;
+}
+
+int test_size_classes()
+{
+	int ret = 1;
+	int i = 0;
+	int count = 0;
+	void* p[4] = { NULL };
+	size_t classes[64] = { 0 };
+	size_t obj_size[3] = { 24, 40, 64 };
+	elr_mpl_class_stats_t stats[8];
+	elr_mpl_t multi = elr_mpl_create_multi(NULL, 3, obj_size, NULL, NULL);
+
+	/*no class wastes more than a quarter above the pointer granularity*/
+	count = elr_mpl_geometric_classes(16, 8192, 0.25, classes, 64);
+	if (count > 64 || classes[0] != 16 || classes[count - 1] != 8192)
+		ret = 0;
+	for (i = 1; i < count && i < 64; i++)
+	{
+		if (classes[i] <= classes[i - 1]
+			|| (classes[i] - classes[i - 1] > sizeof(void*)
+			&& (double)(classes[i] - classes[i - 1] - 1) / classes[i] > 0.25))
+			ret = 0;
+	}
+	if (elr_mpl_geometric_classes(16, 8192, 0.25, NULL, 0) != count)
+		ret = 0;
+
+	p[0] = elr_mpl_alloc_multi(&multi, 20);
+	p[1] = elr_mpl_alloc_multi(&multi, 20);
+	p[2] = elr_mpl_alloc_multi(&multi, 40);
+	p[3] = elr_mpl_alloc_multi(&multi, 3000);
+
+	/*declared classes, then pools above them*/
+	if (elr_mpl_class_stats(&multi, stats, 8) != 4
+		|| stats[0].object_size != 24 || stats[0].slice_count != 2
+		|| stats[3].object_size != 3072 || stats[3].slice_count != 1)
+		ret = 0;
+#ifdef ELR_USE_HISTOGRAM
+	if (stats[0].request_count != 2 || stats[0].requested_size != 40
+		|| stats[0].wasted_size != 8 || stats[1].wasted_size != 0
+		|| stats[3].wasted_size != 72)
+		ret = 0;
+#else
+	if (stats[0].request_count != 0 || stats[0].wasted_size != 0)
+		ret = 0;
+#endif
+
+	for (i = 0; i < 4; i++)
+		elr_mpl_free(p[i]);
+	elr_mpl_destroy(&multi);
+	return ret;
+}
+
+int test_suggest_classes()
+{
+	int ret = 1;
+	int i = 0;
+	int count = 0;
+	size_t sizes[5] = { 20, 24, 40, 3000, 6000 };
+	size_t classes[8] = { 0 };
+	size_t loaded[8] = { 0 };
+	size_t obj_size[2] = { 64, 256 };
+	elr_mpl_t multi = elr_mpl_create_multi(NULL, 2, obj_size, NULL, NULL);
+
+	if (elr_mpl_suggest_classes(&multi, 4, classes) != 0)
+		ret = 0;
+
+	elr_mpl_set_profiling(&multi, 1);
+	for (i = 0; i < 1000; i++)
+		elr_mpl_free(elr_mpl_alloc_multi(&multi, sizes[i % 5]));
+	elr_mpl_set_profiling(&multi, 0);
+	elr_mpl_free(elr_mpl_alloc_multi(&multi, 100));
+
+	/*20 and 24 share a bucket*/
+	count = elr_mpl_suggest_classes(&multi, 8, classes);
+	if (count != 4 || classes[0] != 24 || classes[1] != 40
+		|| classes[2] != 3000 || classes[3] != 6000)
+		ret = 0;
+	count = elr_mpl_suggest_classes(&multi, 2, classes);
+	if (count != 2 || classes[0] != 40 || classes[1] != 6000)
+		ret = 0;
+
+	if (elr_mpl_save_classes("elr_mpl_classes.txt", count, classes) == 0
+		|| elr_mpl_load_classes("elr_mpl_classes.txt", loaded, 8) != count
+		|| loaded[0] != 40 || loaded[1] != 6000
+		|| elr_mpl_load_classes("elr_mpl_classes.txt", loaded, 1) != 0)
+		ret = 0;
+	remove("elr_mpl_classes.txt");
+
+	elr_mpl_profile_reset(&multi);
+	if (elr_mpl_suggest_classes(&multi, 4, classes) != 0)
+		ret = 0;
+
+	elr_mpl_destroy(&multi);
+	return ret;
+}
+
+int test_heap_sampling()
+{
+	int ret = 1;
+	int i = 0;
+	char line[128] = { 0 };
+	void* mem[10] = { NULL };
+	FILE* file = NULL;
+	elr_mpl_t pool = elr_mpl_create(NULL, 64, NULL, NULL);
+
+	/*not compiled in*/
+	if (elr_mpl_set_sampling(1) == 0)
+	{
+		elr_mpl_destroy(&pool);
+		return elr_mpl_heap_dump("elr_mpl_heap.prof") == 0;
+	}
+
+	/*a rate of one byte samples every block*/
+	for (i = 0; i < 10; i++)
+		mem[i] = elr_mpl_alloc(&pool);
+	elr_mpl_set_sampling(0);
+	for (i = 0; i < 5; i++)
+		elr_mpl_free(mem[i]);
+	elr_mpl_free(elr_mpl_alloc(&pool));
+
+	if (elr_mpl_heap_dump("elr_mpl_heap.prof") == 0
+		|| (file = fopen("elr_mpl_heap.prof", "r")) == NULL)
+		ret = 0;
+	else
+	{
+		if (fgets(line, sizeof(line), file) == NULL
+			|| strcmp(line, "heap profile: 5: 320 [0: 0] @ heap_v2/1\n") != 0)
+			ret = 0;
+		fclose(file);
+	}
+
+	/*records go with the pool*/
+	elr_mpl_destroy(&pool);
+	if (elr_mpl_heap_dump("elr_mpl_heap.prof") == 0
+		|| (file = fopen("elr_mpl_heap.prof", "r")) == NULL)
+		ret = 0;
+	else
+	{
+		if (fgets(line, sizeof(line), file) == NULL
+			|| strcmp(line, "heap profile: 0: 0 [0: 0] @ heap_v2/1\n") != 0)
+			ret = 0;
+		fclose(file);
+	}
+	remove("elr_mpl_heap.prof");
+
+	return ret;
+}
 
 void clear_fragments()
 {
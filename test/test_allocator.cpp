@@ -0,0 +1,104 @@
+#include <cstddef>
+#include <list>
+#include <map>
+#include <vector>
+#include "elr_mpl_allocator.hpp"
+
+/* cache line sized type, over-aligned beyond max_align_t */
+#if defined(_MSC_VER)
+__declspec(align(64)) struct cache_line { char data[40]; };
+#else
+struct cache_line { char data[40]; } __attribute__((aligned(64)));
+#endif
+
+static int aligned(const void* mem, std::size_t align)
+{
+	return ((std::size_t)mem & (align - 1)) == 0;
+}
+
+static int alloc_types()
+{
+	int ret = 1;
+	int i = 0;
+	int sum = 0;
+	std::size_t max_align = ELR_MPL_ALIGNOF(elr_mpl_max_align_t);
+	elr_mpl_allocator<cache_line> line_alloc;
+	cache_line* line = NULL;
+	cache_line* lines[10] = { NULL };
+	std::vector<double, elr_mpl_allocator<double> >* vecs[50] = { NULL };
+	std::list<int, elr_mpl_allocator<int> > lst;
+	std::map<int, int, std::less<int>, elr_mpl_allocator<std::pair<const int, int> > > m;
+
+	/*arrays are aligned to max_align_t*/
+	for (i = 0; i < 50; i++)
+	{
+		vecs[i] = new std::vector<double, elr_mpl_allocator<double> >(12, 1.0);
+		if (!aligned(&(*vecs[i])[0], max_align))
+			ret = 0;
+	}
+	for (i = 0; i < 50; i++)
+		delete vecs[i];
+
+	/*over-aligned types keep their alignment, single or in arrays*/
+	for (i = 0; i < 10; i++)
+	{
+		lines[i] = line_alloc.allocate(i % 2 == 0 ? 1 : 3);
+		if (!aligned(lines[i], ELR_MPL_ALIGNOF(cache_line)))
+			ret = 0;
+	}
+	for (i = 0; i < 10; i++)
+		line_alloc.deallocate(lines[i], i % 2 == 0 ? 1 : 3);
+	line = line_alloc.allocate(100);
+	if (!aligned(line, ELR_MPL_ALIGNOF(cache_line)))
+		ret = 0;
+	line_alloc.deallocate(line, 100);
+
+	/*node based containers*/
+	for (i = 0; i < 1000; i++)
+	{
+		lst.push_back(i);
+		m[i] = i;
+	}
+	for (i = 0; i < 1000; i += 2)
+		m.erase(i);
+	for (std::list<int, elr_mpl_allocator<int> >::iterator it = lst.begin(); it != lst.end(); ++it)
+		sum += *it;
+	if (sum != 999 * 1000 / 2 || m.size() != 500 || m[999] != 999)
+		ret = 0;
+
+	return ret;
+}
+
+/* pools of the allocator are created again after the module is restarted */
+static int alloc_restart()
+{
+	int ret = 1;
+	double* one = NULL;
+	double* many = NULL;
+	elr_mpl_allocator<double> alloc;
+
+	elr_mpl_finalize();
+	if (elr_mpl_init() == 0)
+		return 0;
+
+	try
+	{
+		one = alloc.allocate(1);
+		many = alloc.allocate(100);
+		alloc.deallocate(one, 1);
+		alloc.deallocate(many, 100);
+	}
+	catch (const std::bad_alloc&)
+	{
+		ret = 0;
+	}
+
+	return ret;
+}
+
+extern "C" int test_mpl_allocator()
+{
+	/*containers of the first part are gone before the module restarts*/
+	int ret = alloc_types();
+	return alloc_restart() && ret;
+}